@@ -0,0 +1,95 @@
+/* arena.c: bump allocator for objects with common lifetime
+ *
+ *  Copyright (c) 2026, Joerg Hoppe
+ *  j_hoppe@t-online.de, www.retrocmp.com
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *  TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  18-Oct-2026  JH  created
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "arena.h"
+
+// alignment of all allocations
+#define ARENA_ALIGN	8
+
+static arena_chunk_t *arena_chunk_create(size_t size) {
+	arena_chunk_t *chunk = malloc(sizeof(arena_chunk_t) + size);
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+	return chunk;
+}
+
+arena_t *arena_create(size_t chunk_size) {
+	arena_t *_this = malloc(sizeof(arena_t));
+	_this->chunk_size = chunk_size;
+	_this->first = _this->cur = arena_chunk_create(chunk_size);
+	return _this;
+}
+
+void arena_destroy(arena_t *_this) {
+	arena_chunk_t *chunk, *next;
+	for (chunk = _this->first; chunk; chunk = next) {
+		next = chunk->next;
+		free(chunk);
+	}
+	free(_this);
+}
+
+// memory for "size" bytes, valid until arena_reset(). Not initialized.
+void *arena_alloc(arena_t *_this, size_t size) {
+	void *result;
+	size = (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+	while (_this->cur->used + size > _this->cur->size) {
+		arena_chunk_t *next = _this->cur->next;
+		if (!next || next->size < size) {
+			// append new chunk, or insert one large enough
+			size_t chunk_size = size > _this->chunk_size ? size : _this->chunk_size;
+			next = arena_chunk_create(chunk_size);
+			next->next = _this->cur->next;
+			_this->cur->next = next;
+		}
+		_this->cur = next;
+		_this->cur->used = 0; // reused after reset
+	}
+	result = _this->cur->data + _this->cur->used;
+	_this->cur->used += size;
+	return result;
+}
+
+// release all allocations at once. Chunks are kept for reuse
+void arena_reset(arena_t *_this) {
+	_this->cur = _this->first;
+	_this->cur->used = 0;
+}
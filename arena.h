@@ -0,0 +1,65 @@
+/* arena.h: bump allocator for objects with common lifetime
+ *
+ *  Copyright (c) 2026, Joerg Hoppe
+ *  j_hoppe@t-online.de, www.retrocmp.com
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *  TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  18-Oct-2026  JH  created
+ */
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct arena_chunk_struct {
+	struct arena_chunk_struct *next;
+	size_t size; // usable bytes in data[]
+	size_t used;
+	uint8_t data[];
+} arena_chunk_t;
+
+// objects are allocated sequentially and freed all together by arena_reset()
+typedef struct {
+	arena_chunk_t *first;
+	arena_chunk_t *cur; // allocate from here
+	size_t chunk_size; // default size of new chunks
+} arena_t;
+
+arena_t *arena_create(size_t chunk_size);
+void arena_destroy(arena_t *_this);
+
+void *arena_alloc(arena_t *_this, size_t size);
+void arena_reset(arena_t *_this);
+
+#endif /* _ARENA_H_ */
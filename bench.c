@@ -0,0 +1,382 @@
+/* bench.c: micro benchmarks for the PDP filesystem code of tu58fs
+ *
+ *  Copyright (c) 2026, Joerg Hoppe
+ *  j_hoppe@t-online.de, www.retrocmp.com
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ *  - Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *  TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  18-Oct-2026  JH  parse/render/sort/print_dir suite over all devices
+ *  18-Oct-2026  JH  created
+ *
+ *  Not part of tu58fs, build and run with "make bench".
+ *  Measures the RAD-50 and DOS-11 date codecs, then synthesizes
+ *  XXDP and RT-11 volumes for every device in device_info_table
+ *  and times parse, render, file name sort and print_dir.
+ *  Options: make bench BENCH_ARGS="-n <files> -s small|mixed|large -l <loops>"
+ *
+ *  Allocations are counted by wrapping malloc() & friends with the linker
+ *  (see Makefile), so only calls from tu58fs modules are seen.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "error.h"
+#include "utils.h"
+#include "device_info.h"
+#include "xxdp_radi.h"
+#include "rt11_radi.h"
+#include "filesort.h"
+#include "filesystem.h"
+
+// globals of main.c used by the linked modules
+int opt_verbose = 0;
+int opt_debug = 0;
+int opt_background = 1; // no info and warnings in timed loops, errors still printed
+
+#define BENCH_CODEC_WORDS	0x10000
+#define BENCH_CODEC_LOOPS	100
+#define BENCH_MAX_FILE_COUNT	1000 // more never fit on XXDP or RT-11
+#define BENCH_MAX_FILE_BLOCKS	128
+
+// size distributions of synthesized files
+typedef enum {
+	dist_small = 0, // 1..512 bytes
+	dist_mixed = 1, // 1..64 blocks, mostly small
+	dist_large = 2 // 16..128 blocks
+} bench_dist_t;
+
+static char *bench_dist_name[] = { "small", "mixed", "large", NULL };
+
+static int opt_file_count = 1000;
+static bench_dist_t opt_dist = dist_mixed;
+static int opt_loops = 10;
+
+// count allocations of the linked modules. -Wl,--wrap=malloc etc.
+static unsigned long bench_alloc_count;
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+	bench_alloc_count++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size) {
+	bench_alloc_count++;
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+	bench_alloc_count++;
+	return __real_realloc(ptr, size);
+}
+
+static uint64_t bench_now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void bench_print(char *name, uint64_t ns, unsigned ops) {
+	printf("%-32s %10.1f ns/op %12.0f op/s\n", name, (double) ns / ops,
+			ops * 1e9 / (ns ? ns : 1));
+}
+
+// peak resident set size of the whole process so far in KB.
+// Not per volume: getrusage() gives only the maximum since process start
+static long bench_maxrss_kb() {
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_maxrss;
+}
+
+// size of the i-th synthesized file, reproducible
+static uint32_t bench_file_size(int i) {
+	uint32_t r = (uint32_t) i * 2654435761u; // Knuth multiplicative hash
+	r ^= r >> 15;
+	switch (opt_dist) {
+	case dist_small:
+		return 1 + r % 512;
+	case dist_mixed:
+		// 1, 2, 4 .. 64 blocks, with random tail
+		return (512 << (r % 7)) - (r >> 8) % 512;
+	case dist_large:
+	default:
+		return 512 * (16 + r % (BENCH_MAX_FILE_BLOCKS - 16 + 1));
+	}
+}
+
+// throughput of RAD-50 filename and DOS-11 date codecs
+static void bench_codecs() {
+	uint16_t *w = malloc(BENCH_CODEC_WORDS * sizeof(uint16_t));
+	struct tm *t = malloc(BENCH_CODEC_WORDS * sizeof(struct tm));
+	char filnam[7], ext[4];
+	uint32_t sum = 0;
+	uint64_t start;
+	unsigned i, loop;
+
+	// only valid RAD-50 words
+	for (i = 0; i < BENCH_CODEC_WORDS; i++)
+		w[i] = (i * 40503u) % (050 * 050 * 050);
+
+	start = bench_now_ns();
+	for (loop = 0; loop < BENCH_CODEC_LOOPS; loop++)
+		for (i = 0; i + 3 <= BENCH_CODEC_WORDS; i += 3) {
+			rad50_decode_filename(w + i, filnam, ext);
+			sum += filnam[0] + ext[2];
+		}
+	bench_print("rad50_decode_filename", bench_now_ns() - start,
+			BENCH_CODEC_LOOPS * (BENCH_CODEC_WORDS / 3));
+
+	start = bench_now_ns();
+	for (loop = 0; loop < BENCH_CODEC_LOOPS; loop++)
+		for (i = 0; i + 3 <= BENCH_CODEC_WORDS; i += 3) {
+			uint16_t nw[3];
+			rad50_encode_filename("SWAP", "SYS", nw);
+			sum += nw[0] + nw[2];
+		}
+	bench_print("rad50_encode_filename", bench_now_ns() - start,
+			BENCH_CODEC_LOOPS * (BENCH_CODEC_WORDS / 3));
+
+	// dates 1970..2035
+	for (i = 0; i < BENCH_CODEC_WORDS; i++)
+		w[i] = 1000 * (i % 66) + 1 + (i % 365);
+
+	start = bench_now_ns();
+	for (loop = 0; loop < BENCH_CODEC_LOOPS; loop++) {
+		dos11date_decode_array(w, t, BENCH_CODEC_WORDS);
+		sum += t[loop].tm_mday;
+	}
+	bench_print("dos11date_decode_array", bench_now_ns() - start,
+			BENCH_CODEC_LOOPS * BENCH_CODEC_WORDS);
+
+	start = bench_now_ns();
+	for (loop = 0; loop < BENCH_CODEC_LOOPS; loop++) {
+		dos11date_encode_array(t, w, BENCH_CODEC_WORDS);
+		sum += w[loop];
+	}
+	bench_print("dos11date_encode_array", bench_now_ns() - start,
+			BENCH_CODEC_LOOPS * BENCH_CODEC_WORDS);
+
+	printf("(checksum %u)\n", sum);
+	free(t);
+	free(w);
+}
+
+// result of one device/filesystem combination
+typedef struct {
+	uint64_t ns; // sum of all loops
+	unsigned long allocs;
+} bench_phase_t;
+
+// add the first "file_count" files to an initialized filesystem
+static int bench_fill(filesystem_t *fs, char **name, uint8_t *data, int file_count) {
+	int i;
+	for (i = 0; i < file_count; i++)
+		if (filesystem_file_add(fs, name[i], 0, 0644, data, bench_file_size(i), 1))
+			return i;
+	return file_count;
+}
+
+// synthesize a volume on a device, time parse, render, name sort and print_dir
+static void bench_volume(filesystem_type_t fs_type, device_info_t *device_info,
+		int block_count, char **name, uint8_t *data, FILE *devnull) {
+	uint32_t image_size = block_count * 512;
+	uint8_t *image = calloc(image_size, 1);
+	char **sortname = malloc((opt_file_count + 1) * sizeof(char *));
+	bench_phase_t parse, render, sort, print_dir;
+	FILE *ferr_saved = ferr;
+	filesystem_t *fs;
+	uint64_t start;
+	unsigned long allocs;
+	int file_count;
+	int i;
+
+	fs = filesystem_create(fs_type, device_info->device_type, 0, image, image_size, NULL);
+
+	// how many files fit? file_add() checks blocks, but render()
+	// may still overflow the directory. Error messages not shown
+	ferr = devnull;
+	filesystem_init(fs);
+	file_count = bench_fill(fs, name, data, opt_file_count);
+	while (file_count > 0 && filesystem_render(fs, NULL)) {
+		file_count = file_count * 9 / 10;
+		filesystem_init(fs);
+		bench_fill(fs, name, data, file_count);
+	}
+	ferr = ferr_saved;
+
+	// render: add files to an empty filesystem, write image
+	allocs = bench_alloc_count;
+	start = bench_now_ns();
+	for (i = 0; i < opt_loops; i++) {
+		filesystem_init(fs);
+		bench_fill(fs, name, data, file_count);
+		if (filesystem_render(fs, NULL)) {
+			printf("%-6s %-4s %6d: render failed\n", device_info->device_name,
+					filesystem_name(fs_type), block_count);
+			goto done;
+		}
+	}
+	render.ns = bench_now_ns() - start;
+	render.allocs = bench_alloc_count - allocs;
+
+	// parse the rendered image
+	allocs = bench_alloc_count;
+	start = bench_now_ns();
+	for (i = 0; i < opt_loops; i++) {
+		filesystem_init(fs);
+		if (filesystem_parse(fs)) {
+			printf("%-6s %-4s %6d: parse failed\n", device_info->device_name,
+					filesystem_name(fs_type), block_count);
+			goto done;
+		}
+	}
+	parse.ns = bench_now_ns() - start;
+	parse.allocs = bench_alloc_count - allocs;
+
+	// sort host file names into filesystem order, as hostdir does before render.
+	// The layout itself is part of render
+	allocs = bench_alloc_count;
+	start = bench_now_ns();
+	for (i = 0; i < opt_loops; i++) {
+		memcpy(sortname, name, file_count * sizeof(char *));
+		sortname[file_count] = NULL;
+		filename_sort(sortname, file_count, filesystem_fileorder(fs), -1, NULL);
+	}
+	sort.ns = bench_now_ns() - start;
+	sort.allocs = bench_alloc_count - allocs;
+
+	// directory listing of the parsed filesystem
+	allocs = bench_alloc_count;
+	start = bench_now_ns();
+	for (i = 0; i < opt_loops; i++)
+		filesystem_print_dir(fs, devnull);
+	print_dir.ns = bench_now_ns() - start;
+	print_dir.allocs = bench_alloc_count - allocs;
+
+	printf("%-6s %-4s %6d %5d | %9.1f %9.1f %9.1f %9.1f | %6lu %6lu %6lu %6lu | %8ld\n",
+			device_info->device_name, filesystem_name(fs_type), block_count, file_count, //
+			parse.ns / 1e3 / opt_loops, render.ns / 1e3 / opt_loops,
+			sort.ns / 1e3 / opt_loops, print_dir.ns / 1e3 / opt_loops, //
+			parse.allocs / opt_loops, render.allocs / opt_loops,
+			sort.allocs / opt_loops, print_dir.allocs / opt_loops, //
+			bench_maxrss_kb());
+done:
+	filesystem_destroy(fs);
+	free(sortname);
+	free(image);
+}
+
+// all devices with both filesystems, if defined for the device
+static void bench_devices() {
+	uint8_t *data = calloc(BENCH_MAX_FILE_BLOCKS, 512);
+	char **name = malloc(opt_file_count * sizeof(char *));
+	FILE *devnull = fopen("/dev/null", "w");
+	device_info_t *device_info;
+	int i;
+
+	for (i = 0; i < opt_file_count; i++) {
+		name[i] = malloc(16);
+		sprintf(name[i], "F%05d.DAT", i);
+	}
+	memset(data, 0x55, BENCH_MAX_FILE_BLOCKS * 512);
+
+	printf("\n%d files, size distribution \"%s\", %d loops\n", opt_file_count,
+			bench_dist_name[opt_dist], opt_loops);
+	printf("sort: file names into filesystem order. peak: resident set of process so far\n");
+	printf("%-6s %-4s %6s %5s | %9s %9s %9s %9s | %6s %6s %6s %6s | %8s\n", "device", "fs",
+			"blocks", "files", "parse us", "render us", "sort us", "dir us", "allocs",
+			"allocs", "allocs", "allocs", "peak K");
+	for (device_info = device_info_table; device_info->device_type; device_info++) {
+		int xxdp = search_tagged_array(xxdp_radi, sizeof(xxdp_radi_t),
+				device_info->device_type) != NULL;
+		int rt11 = search_tagged_array(rt11_radi, sizeof(rt11_radi_t),
+				device_info->device_type) != NULL;
+		if (xxdp)
+			bench_volume(fsXXDP, device_info, device_info->block_count, name, data, devnull);
+		if (rt11)
+			bench_volume(fsRT11, device_info, device_info->block_count, name, data, devnull);
+		// oversized TU58 images
+		if (device_info->max_block_count > device_info->block_count) {
+			if (xxdp)
+				bench_volume(fsXXDP, device_info, device_info->max_block_count, name, data,
+						devnull);
+			if (rt11)
+				bench_volume(fsRT11, device_info, device_info->max_block_count, name, data,
+						devnull);
+		}
+	}
+
+	fclose(devnull);
+	for (i = 0; i < opt_file_count; i++)
+		free(name[i]);
+	free(name);
+	free(data);
+}
+
+int main(int argc, char *argv[]) {
+	int c;
+	ferr = stderr;
+	while ((c = getopt(argc, argv, "n:s:l:")) != -1) {
+		switch (c) {
+		case 'n':
+			opt_file_count = atoi(optarg);
+			if (opt_file_count < 1 || opt_file_count > BENCH_MAX_FILE_COUNT)
+				fatal("File count must be 1..%d", BENCH_MAX_FILE_COUNT);
+			break;
+		case 's':
+			for (opt_dist = 0; bench_dist_name[opt_dist]; opt_dist++)
+				if (!strcmp(optarg, bench_dist_name[opt_dist]))
+					break;
+			if (!bench_dist_name[opt_dist])
+				fatal("Size distribution must be small, mixed or large");
+			break;
+		case 'l':
+			opt_loops = atoi(optarg);
+			if (opt_loops < 1)
+				fatal("Loop count must be > 0");
+			break;
+		default:
+			fatal("Usage: %s [-n <files>] [-s small|mixed|large] [-l <loops>]", argv[0]);
+		}
+	}
+	bench_codecs();
+	bench_devices();
+	return 0;
+}
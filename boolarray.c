@@ -33,6 +33,7 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026  JH  boolarray_is_empty()
  *  07-May-2017  JH  passes GCC warning levels -Wall -Wextra
  *  20-Jan-2017  JH  created
  */
@@ -46,7 +47,7 @@
 boolarray_t *boolarray_create(uint32_t bitcount) {
 	boolarray_t *result = malloc(sizeof(boolarray_t));
 	result->bitcount = bitcount;
-	result->flags = malloc((bitcount / 32) + 1);
+	result->flags = malloc(((bitcount / 32) + 1) * sizeof(uint32_t));
 	boolarray_clear(result);
 	return result;
 }
@@ -57,7 +58,7 @@ void boolarray_destroy(boolarray_t *_this) {
 }
 
 void boolarray_clear(boolarray_t *_this) {
-	memset(_this->flags, 0, _this->bitcount / 32 + 1);
+	memset(_this->flags, 0, (_this->bitcount / 32 + 1) * sizeof(uint32_t));
 }
 
 void boolarray_bit_set(boolarray_t *_this, uint32_t i) {
@@ -80,6 +81,18 @@ int boolarray_bit_get(boolarray_t *_this, uint32_t i) {
 	return !!(w & (1 << (i % 32)));
 }
 
+// 1, if none of the first "bitcount" bits is set. bitcount 0: all bits
+int boolarray_is_empty(boolarray_t *_this, uint32_t bitcount) {
+	uint32_t i;
+	if (bitcount <= 0 || bitcount > _this->bitcount)
+		bitcount = _this->bitcount;
+	// whole words: a set bit just beyond bitcount counts too
+	for (i = 0; i < bitcount / 32 + 1; i++)
+		if (_this->flags[i])
+			return 0;
+	return 1;
+}
+
 // dump state of irst "bitcount" bits
 void boolarray_print_diag(boolarray_t *_this, FILE *stream, uint32_t bitcount, char *info) {
 	int any = 0;
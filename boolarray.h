@@ -33,6 +33,7 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026  JH  boolarray_is_empty()
  *  07-May-2017  JH  passes GCC warning levels -Wall -Wextra
  *  20-Jan-2017  JH  created
  */
@@ -56,6 +57,7 @@ void boolarray_clear(boolarray_t *_this);
 void boolarray_bit_set(boolarray_t *_this, uint32_t i);
 void boolarray_bit_clear(boolarray_t *_this, uint32_t i);
 int boolarray_bit_get(boolarray_t *_this, uint32_t i);
+int boolarray_is_empty(boolarray_t *_this, uint32_t bitcount);
 // unsecure & fast
 #define BOOLARRAY_BIT_GET(_this,i) ( !! ((_this)->flags[(i) / 32] & (1 << ((i) % 32))) )
 
@@ -169,7 +169,7 @@ device_type_t device_type_from_name(char * name) {
 }
 
 char *device_type_namelist() {
-	static char buffer[1024];
+	static THREAD_LOCAL char buffer[1024];
 	device_info_t *di ;
 	buffer[0] = 0;
 	for (di = device_info_table ; di->device_type ; di++) {
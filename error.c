@@ -33,6 +33,7 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026  JH  error_code per thread
  *  29-Jan-2017  JH  created
  */
 
@@ -48,8 +49,8 @@
 
 FILE *ferr = NULL; // variable error stream
 
-// global last raised error
-int error_code;
+// last raised error, per thread
+THREAD_LOCAL int error_code;
 // a stack of messages, for several caller infos
 //int error_trace_level;
 //char error_message[ERROR_MAX_TRACE_LEVEL + 1][1024];
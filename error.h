@@ -40,6 +40,7 @@
 #define _ERROR_H_
 
 #include <stdio.h>
+#include "utils.h"	// THREAD_LOCAL
 
 // possible errors
 #define ERROR_OK	0
@@ -64,7 +65,7 @@
 
 #ifndef _ERROR_C_
 extern FILE *ferr; // variable error stream
-extern int error_code ;
+extern THREAD_LOCAL int error_code ; // per thread
 //extern char  error_message[ERROR_MAX_TRACE_LEVEL+1][1024] ;
 #endif
 
@@ -33,6 +33,8 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026  JH  regexes compiled once per group list, groups of names cached
+ *  18-Oct-2026  JH  optional hotness per name
  *  20-Jan-2017  JH  created
  *
  * Sorts filenames according to list of regular expressions
@@ -55,12 +57,18 @@
  * a files matches the general at first and never the specific.
  * However, if a file matches the pattern exactly (no regex), it can be moved to the end
  *
+ * With hotness[] given, files within a group are sorted by descending hotness,
+ * then by name. Groups keep their order, boot files stay in place.
+ *
  *  Created on: 17.01.2017
  *      Author: root
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
+#include <ctype.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <regex.h>
 
@@ -72,6 +80,7 @@
 typedef struct {
 	char *name;
 	int group; // matches this regex
+	uint32_t hotness; // access count, 0 if not used
 } sort_name_entry_t;
 
 // a compiled group rgeex
@@ -81,7 +90,30 @@ typedef struct {
 	regex_t reg; // compiled
 } sort_group_regex_t;
 
+// group of a name, remembered across calls
+typedef struct {
+	char *name; // NULL = empty slot
+	int group;
+} sort_memo_entry_t;
+
+// compiled group list, one per fileorder[] (that is: per filesystem type)
+typedef struct sort_group_cache_struct {
+	char **group; // the list, identified by address
+	int group_count;
+	sort_group_regex_t *regex;
+	// names already assigned, open addressing by case insensitive hash
+	sort_memo_entry_t *memo;
+	unsigned memo_size; // power of 2
+	unsigned memo_count;
+	struct sort_group_cache_struct *next;
+} sort_group_cache_t;
+
 #define	NOGROUP 0xffffff // no group index, sorts to the end
+#define SORT_MEMO_MAX	0x10000 // memo is cleared when full
+
+// filename_sort() is called by sync threads of all units
+static sort_group_cache_t *group_cache = NULL;
+static pthread_mutex_t group_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 // compare name entry first by group, then by name
 static int name_compare(const void *n1, const void *n2) {
@@ -91,19 +123,123 @@ static int name_compare(const void *n1, const void *n2) {
 		return -1;
 	else if (name1->group > name2->group)
 		return 1;
+	else if (name1->hotness > name2->hotness)
+		return -1;
+	else if (name1->hotness < name2->hotness)
+		return 1;
 	else
 		return strcasecmp(name1->name, name2->name);
 
 }
 
+// find compiled list for group[], compile on first use
+static sort_group_cache_t *group_cache_get(char **group, int group_count) {
+	sort_group_cache_t *gc;
+	int i, err;
+	char errbuff[1024];
+
+	for (gc = group_cache; gc; gc = gc->next)
+		if (gc->group == group && gc->group_count == group_count)
+			return gc;
+
+	gc = malloc(sizeof(sort_group_cache_t));
+	gc->group = group;
+	gc->group_count = group_count;
+	gc->regex = calloc(group_count, sizeof(sort_group_regex_t));
+	// compile all regex. case is ignored
+	for (i = 0; i < group_count; i++) {
+		gc->regex[i].pattern = group[i];
+		gc->regex[i].group = i; // enumerate
+		err = regcomp(&gc->regex[i].reg, gc->regex[i].pattern, REG_ICASE | REG_NOSUB);
+		if (err) {
+			regerror(err, &gc->regex[i].reg, errbuff, sizeof(errbuff));
+			fprintf(ferr, "Error compiling regex: %s", errbuff);
+		}
+	}
+	gc->memo_size = 256;
+	gc->memo_count = 0;
+	gc->memo = calloc(gc->memo_size, sizeof(sort_memo_entry_t));
+	gc->next = group_cache;
+	group_cache = gc;
+	return gc;
+}
+
+static unsigned memo_hash(char *name) {
+	char buff[4096];
+	unsigned n;
+	for (n = 0; name[n] && n < sizeof(buff); n++)
+		buff[n] = toupper((unsigned char) name[n]);
+	return (unsigned) memhash(buff, n, MEMHASH_INIT);
+}
+
+// slot of name, or the empty slot where to insert it
+static sort_memo_entry_t *memo_slot(sort_group_cache_t *gc, char *name) {
+	unsigned i = memo_hash(name) & (gc->memo_size - 1);
+	while (gc->memo[i].name && strcasecmp(gc->memo[i].name, name))
+		i = (i + 1) & (gc->memo_size - 1);
+	return &gc->memo[i];
+}
+
+static void memo_clear(sort_group_cache_t *gc) {
+	unsigned i;
+	for (i = 0; i < gc->memo_size; i++)
+		if (gc->memo[i].name) {
+			free(gc->memo[i].name);
+			gc->memo[i].name = NULL;
+		}
+	gc->memo_count = 0;
+}
+
+static void memo_insert(sort_group_cache_t *gc, char *name, int group) {
+	sort_memo_entry_t *slot;
+	if (gc->memo_count >= SORT_MEMO_MAX)
+		memo_clear(gc); // many different names over time
+	if (2 * (gc->memo_count + 1) > gc->memo_size) {
+		// grow, keep load below 1/2
+		sort_memo_entry_t *old = gc->memo;
+		unsigned i, old_size = gc->memo_size;
+		gc->memo_size *= 2;
+		gc->memo = calloc(gc->memo_size, sizeof(sort_memo_entry_t));
+		for (i = 0; i < old_size; i++)
+			if (old[i].name)
+				*memo_slot(gc, old[i].name) = old[i];
+		free(old);
+	}
+	slot = memo_slot(gc, name);
+	slot->name = strdup(name);
+	slot->group = group;
+	gc->memo_count++;
+}
+
+// group of a name: exact pattern match first, then first matching regex
+static int name_group(sort_group_cache_t *gc, char *name) {
+	sort_memo_entry_t *slot;
+	int j, group;
+
+	slot = memo_slot(gc, name);
+	if (slot->name)
+		return slot->group;
+
+	group = NOGROUP;
+	// 1) match against the exact pattern, no regex
+	for (j = 0; group == NOGROUP && j < gc->group_count; j++)
+		if (!strcasecmp(gc->regex[j].pattern, name))
+			group = j;
+	// 2) match against the regexes, first match defines group
+	for (j = 0; group == NOGROUP && j < gc->group_count; j++)
+		if (regexec(&gc->regex[j].reg, name, 0, NULL, 0) == 0)
+			group = j;
+	memo_insert(gc, name, group);
+	return group;
+}
+
 // *count maybe -1, then lists are NULL terminated
-void filename_sort(char **name, int name_count, char **group, int group_count) {
+// hotness[]: parallel to name[], may be NULL
+void filename_sort(char **name, int name_count, char **group, int group_count,
+		uint32_t *hotness) {
 	sort_name_entry_t *_name;
-	sort_group_regex_t *_group;
-	int i, j;
-	int err;
-	char errbuff[1024];
-	int match;
+	sort_group_cache_t *gc;
+	int i;
 
 	// if name/group_size undefined: search for terminating NULL
 	if (name_count < 0)
@@ -113,47 +249,16 @@ void filename_sort(char **name, int name_count, char **group, int group_count) {
 		for (group_count = 0; group[group_count]; group_count++)
 			;
 
-	// allocate internal lists. internals have prefix "_"
+	// internal list with sort key. internals have prefix "_"
 	_name = calloc(name_count, sizeof(sort_name_entry_t));
-	_group = calloc(group_count, sizeof(sort_group_regex_t));
-
-	// init lists with params
+	pthread_mutex_lock(&group_cache_mutex);
+	gc = group_cache_get(group, group_count);
 	for (i = 0; i < name_count; i++) {
 		_name[i].name = name[i];
-		_name[i].group = NOGROUP;
-	}
-
-	for (i = 0; i < group_count; i++) {
-		_group[i].pattern = group[i];
-		_group[i].group = i; // enumerate
+		_name[i].group = name_group(gc, name[i]);
+		_name[i].hotness = hotness ? hotness[i] : 0;
 	}
-
-	// compile all regex. case is ignored
-	for (i = 0; i < group_count; i++) {
-		err = regcomp(&_group[i].reg, _group[i].pattern, REG_ICASE | REG_NOSUB);
-		if (err) {
-			regerror(err, &_group[i].reg, errbuff, sizeof(errbuff));
-			fprintf(ferr, "Error compiling regex: %s", errbuff);
-		}
-	}
-
-	// 1) match each name against the exact patten, no regex
-	for (i = 0; i < name_count; i++)
-		for (match = j = 0; !match && j < group_count; j++)
-			if (!strcasecmp(_group[j].pattern, _name[i].name)) {
-				_name[i].group = j;
-				match = 1;
-			}
-
-	// 2) match each name against the regexes, first match defines group
-	for (i = 0; i < name_count; i++)
-		if (_name[i].group == NOGROUP) // refine, not reDEfine
-			for (match = j = 0; !match && j < group_count; j++) {
-				if (regexec(&_group[j].reg, _name[i].name, 0, NULL, 0) == 0) {
-					_name[i].group = j;
-					match = 1;
-				}
-			}
+	pthread_mutex_unlock(&group_cache_mutex);
 
 	// sort by group and name
 	qsort(_name, name_count, sizeof(sort_name_entry_t), name_compare);
@@ -161,10 +266,5 @@ void filename_sort(char **name, int name_count, char **group, int group_count) {
 	// result back into input name list
 	for (i = 0; i < name_count; i++)
 		name[i] = _name[i].name;
-
-	/// cleanup
-	for (i = 0; i < group_count; i++)
-		regfree(&_group[i].reg);
 	free(_name);
-	free(_group);
 }
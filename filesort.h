@@ -33,12 +33,16 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026  JH  optional hotness per name
  *  20-Jan-2017  JH  created
  */
 
 #ifndef FILESORT_H_
 #define FILESORT_H_
 
-void filename_sort(char **name, int name_count, char **group, int group_count);
+#include <stdint.h>
+
+void filename_sort(char **name, int name_count, char **group, int group_count,
+		uint32_t *hotness);
 
 #endif /* FILESORT_H_ */
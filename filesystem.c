@@ -33,6 +33,14 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026  JH  file index of blocks
+ *  18-Oct-2026  JH  list of patched words
+ *  18-Oct-2026  JH  file data loaded on demand
+ *  18-Oct-2026  JH  render reports rewritten blocks
+ *  18-Oct-2026  JH  link to changed block map
+ *  18-Oct-2026  JH  directory blocks reported for sync trigger
+ *  18-Oct-2026  JH  file data can be borrowed from caller
+ *  18-Oct-2026  JH  update/delete single files in parsed image
  *  07-May-2017  JH  passes GCC warning levels -Wall -Wextra
  *  24-Jan-2017  JH  created
  */
@@ -65,7 +73,11 @@ filesystem_t *filesystem_create(filesystem_type_t type, device_type_t device_typ
 	filesystem_t *_this;
 	_this = malloc(sizeof(filesystem_t));
 	_this->type = type;
+	_this->device_type = device_type;
 	_this->readonly = readonly;
+	_this->image_data = image_data;
+	_this->image_data_size = image_data_size;
+	_this->changedblocks = changedblocks;
 	_this->xxdp = NULL;
 	_this->rt11 = NULL;
 
@@ -127,11 +139,13 @@ int filesystem_parse(filesystem_t *_this) {
 // a PDP file can have several streams, "streamname" is
 //
 // the host file is only one stream of a PDP filesystem file
+// borrow: 1 = data[] is not copied, caller keeps it valid until filesystem_init()
 int filesystem_file_add(filesystem_t *_this, char *hostfname, time_t hostfdate, mode_t hostmode,
-		uint8_t *data, uint32_t data_size) {
+		uint8_t *data, uint32_t data_size, int borrow) {
 	switch (_this->type) {
 	case fsXXDP: {
-		return xxdp_filesystem_file_add(_this->xxdp, hostfname, hostfdate, data, data_size);
+		return xxdp_filesystem_file_add(_this->xxdp, hostfname, hostfdate, data, data_size,
+				borrow);
 	}
 	case fsRT11: {
 		char *streamname = NULL;
@@ -142,16 +156,73 @@ int filesystem_file_add(filesystem_t *_this, char *hostfname, time_t hostfdate,
 					|| !strcasecmp(ext, RT11_STREAMNAME_PREFIX))
 				streamname = extract_extension(hostfname, 1); // now clip
 		return rt11_filesystem_file_stream_add(_this->rt11, hostfname, streamname, hostfdate,
-				hostmode, data, data_size);
+				hostmode, data, data_size, borrow);
 	}
 	default:
 		return error_set(ERROR_FILESYSTEM_INVALID, "Filesystem not supported");
 	}
 }
 
+// split "hostfname" into PDP file name and RT-11 stream name.
+// result in static buffer, stream name NULL for main data
+static char *filesystem_hostfname_stream(char *hostfname, char **streamname) {
+	static THREAD_LOCAL char buff[256];
+	char *ext;
+	strncpy(buff, hostfname, sizeof(buff) - 1);
+	buff[sizeof(buff) - 1] = 0;
+	*streamname = NULL;
+	ext = extract_extension(buff, 0); // only test, do not clip
+	// is last extension a known streamname?
+	if (ext)
+		if (!strcasecmp(ext, RT11_STREAMNAME_DIREXT) || !strcasecmp(ext, RT11_STREAMNAME_PREFIX))
+			*streamname = extract_extension(buff, 1); // now clip
+	return buff;
+}
+
+// replace or create a single file stream in a parsed filesystem,
+// directly in the image. Changed blocks are marked in "touched" (may be NULL).
+// ERROR_FILESYSTEM_OVERFLOW without message: needs new layout by _render()
+int filesystem_file_update(filesystem_t *_this, char *hostfname, time_t hostfdate,
+		mode_t hostmode, uint8_t *data, uint32_t data_size, boolarray_t *touched) {
+	switch (_this->type) {
+	case fsXXDP:
+		return xxdp_filesystem_file_update(_this->xxdp, hostfname, hostfdate, data, data_size,
+				touched);
+	case fsRT11: {
+		char *streamname;
+		char *fname = filesystem_hostfname_stream(hostfname, &streamname);
+		return rt11_filesystem_file_stream_update(_this->rt11, fname, streamname, hostfdate,
+				hostmode, data, data_size, touched);
+	}
+	default:
+		return error_set(ERROR_FILESYSTEM_INVALID, "Filesystem not supported");
+	}
+}
+
+// remove a single file stream from a parsed filesystem. See _file_update()
+int filesystem_file_delete(filesystem_t *_this, char *hostfname, boolarray_t *touched) {
+	switch (_this->type) {
+	case fsXXDP:
+		return xxdp_filesystem_file_delete(_this->xxdp, hostfname, touched);
+	case fsRT11: {
+		char *streamname;
+		char *fname = filesystem_hostfname_stream(hostfname, &streamname);
+		return rt11_filesystem_file_stream_delete(_this->rt11, fname, streamname, touched);
+	}
+	default:
+		return error_set(ERROR_FILESYSTEM_INVALID, "Filesystem not supported");
+	}
+}
+
+// parsed XXDP files are loaded on demand. RT-11 streams are views into the image
+void filesystem_file_load(filesystem_t *_this, int fileidx) {
+	if (_this->type == fsXXDP)
+		xxdp_filesystem_file_load(_this->xxdp, fileidx);
+}
+
 // access file streams, bootblock and monitor in an uniform way
 file_t *filesystem_file_get(filesystem_t *_this, int fileidx) {
-	static file_t result;
+	static THREAD_LOCAL file_t result;
 
 	result.filnam[0] = 0;
 	result.ext[0] = 0;
@@ -215,17 +286,50 @@ file_t *filesystem_file_get(filesystem_t *_this, int fileidx) {
 }
 
 // write filesystem into image
-int filesystem_render(filesystem_t *_this) {
+// only changed blocks are written and marked in "touched" (may be NULL)
+int filesystem_render(filesystem_t *_this, boolarray_t *touched) {
 	switch (_this->type) {
 	case fsXXDP:
-		return xxdp_filesystem_render(_this->xxdp);
+		return xxdp_filesystem_render(_this->xxdp, touched);
 	case fsRT11:
-		return rt11_filesystem_render(_this->rt11);
+		return rt11_filesystem_render(_this->rt11, touched);
 	default:
 		return error_set(ERROR_FILESYSTEM_INVALID, "Filesystem not supported");
 	}
 }
 
+// blocks with directory structures: PDP writes to them change the file list
+void filesystem_metadata_blocks(filesystem_t *_this, boolarray_t *mask) {
+	switch (_this->type) {
+	case fsXXDP:
+		xxdp_filesystem_metadata_blocks(_this->xxdp, mask);
+		break;
+	case fsRT11:
+		rt11_filesystem_metadata_blocks(_this->rt11, mask);
+		break;
+	default:
+		break;
+	}
+}
+
+// owner[blocknr] = index of regular file which uses the block, or -1.
+// bootblock, monitor and directories are not files here.
+void filesystem_block_owners(filesystem_t *_this, int *owner, unsigned block_count) {
+	unsigned i;
+	for (i = 0; i < block_count; i++)
+		owner[i] = -1;
+	switch (_this->type) {
+	case fsXXDP:
+		xxdp_filesystem_block_owners(_this->xxdp, owner, block_count);
+		break;
+	case fsRT11:
+		rt11_filesystem_block_owners(_this->rt11, owner, block_count);
+		break;
+	default:
+		break;
+	}
+}
+
 // path file systemobjects in the image: DD.SYS on RT-11
 int filesystem_patch(filesystem_t *_this) {
 	switch (_this->type) {
@@ -250,6 +354,25 @@ int filesystem_unpatch(filesystem_t *_this) {
 	}
 }
 
+// words changed by filesystem_patch(): save may restore them in the outgoing data.
+// "patch" must hold FILESYSTEM_MAX_PATCHES entries
+int filesystem_patch_list(filesystem_t *_this, filesystem_patch_t *patch) {
+	rt11_patch_t rt11_patch[RT11_MAX_PATCHES];
+	int i, count;
+	switch (_this->type) {
+	case fsRT11:
+		count = rt11_filesystem_patch_list(_this->rt11, rt11_patch);
+		for (i = 0; i < count; i++) {
+			patch[i].offset = rt11_patch[i].offset;
+			patch[i].original = rt11_patch[i].original;
+			patch[i].patched = rt11_patch[i].patched;
+		}
+		return count;
+	default:
+		return 0; // XXDP: nothing patched
+	}
+}
+
 void filesystem_print_dir(filesystem_t *_this, FILE *stream) {
 	switch (_this->type) {
 	case fsXXDP:
@@ -33,6 +33,8 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026  JH  file index of blocks
+ *  18-Oct-2026  JH  list of patched words
  *  07-May-2017  JH  passes GCC warning levels -Wall -Wextra
  *  24-Jan-2017  JH  created
  */
@@ -85,10 +87,22 @@ typedef struct {
 
 } file_t;
 
+// a word changed in the image by filesystem_patch(), but not in the disk file
+#define FILESYSTEM_MAX_PATCHES	RT11_MAX_PATCHES
+typedef struct {
+	uint32_t offset; // byte position in image
+	uint16_t original; // value in disk file
+	uint16_t patched; // value in image
+} filesystem_patch_t;
+
 
 typedef struct {
 	filesystem_type_t type ;
+	device_type_t device_type ;
 	int	readonly ;
+	uint8_t *image_data ; // linked image buffer
+	uint32_t image_data_size ;
+	boolarray_t *changedblocks ; // blocks written by PDP since last sync. may be NULL
 	xxdp_filesystem_t *xxdp ;
 	rt11_filesystem_t *rt11 ;
 
@@ -111,17 +125,31 @@ void filesystem_init(filesystem_t *_this) ;
 int filesystem_parse(filesystem_t *_this);
 
 int filesystem_file_add(filesystem_t *_this, char *hostfname, time_t hostfdate,
-		mode_t hostmode, uint8_t *data, uint32_t data_size) ;
+		mode_t hostmode, uint8_t *data, uint32_t data_size, int borrow) ;
 
 file_t *filesystem_file_get(filesystem_t *_this, int fileidx) ;
+// stream data of a parsed file are valid only after this
+void filesystem_file_load(filesystem_t *_this, int fileidx) ;
+
+// modify a parsed filesystem in place
+int filesystem_file_update(filesystem_t *_this, char *hostfname, time_t hostfdate,
+		mode_t hostmode, uint8_t *data, uint32_t data_size, boolarray_t *touched);
+int filesystem_file_delete(filesystem_t *_this, char *hostfname, boolarray_t *touched);
+
+// write filesystem into image, rewritten blocks marked in "touched" (may be NULL)
+int filesystem_render(filesystem_t *_this, boolarray_t *touched);
 
-// write filesystem into image
-int filesystem_render(filesystem_t *_this);
+// mark directory blocks of a parsed filesystem in "mask"
+void filesystem_metadata_blocks(filesystem_t *_this, boolarray_t *mask);
+// index of the regular file using each block of a parsed filesystem, -1 if none
+void filesystem_block_owners(filesystem_t *_this, int *owner, unsigned block_count);
 
 // path file systemobjects in the image: DD.SYS on RT-11
 int filesystem_patch(filesystem_t *_this);
 // undo patches
 int filesystem_unpatch(filesystem_t *_this);
+// words changed by filesystem_patch(), result is count
+int filesystem_patch_list(filesystem_t *_this, filesystem_patch_t *patch);
 
 
 void filesystem_print_dir(filesystem_t *_this, FILE *stream) ;
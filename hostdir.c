@@ -32,6 +32,20 @@
  *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
+ *  18-Oct-2026  JH  access counters, hot files laid out first
+ *  18-Oct-2026  JH  PDP file data loaded only for export
+ *  18-Oct-2026  JH  image reload reports changed blocks
+ *  18-Oct-2026  JH  PDP image parsed only if blocks were written
+ *  18-Oct-2026  JH  host files imported only after quiet period
+ *  18-Oct-2026  JH  one directory scan per tick, with d_type and fstatat()
+ *  18-Oct-2026  JH  snapshot grows dynamically, names interned
+ *  18-Oct-2026  JH  host files mapped into memory, not copied
+ *  18-Oct-2026  JH  host files read by thread pool
+ *  18-Oct-2026  JH  manifest with snapshot and image for fast restart
+ *  18-Oct-2026  JH  host file change by content hash, not only time stamp
+ *  18-Oct-2026  JH  snapshot files found by hash index
+ *  18-Oct-2026  JH  changed host files updated in PDP image, no full reload
+ *  18-Oct-2026  JH  host side changes from inotify, full scan only on event loss
  *  07-May-2017  JH  passes GCC warning levels -Wall -Wextra
  *  05-May-2017  JH/Peter Schranz	compile under MACOS
  *  08-Feb-2017	 JH  do not update PDP file system if readonly
@@ -47,6 +61,9 @@
  *
  *  Detection of change:
  *  on hostdir, filelen and file modification time is compared against snapshot.
+ *  If only the time differs, a content hash decides (touch, backup tools).
+ *  Under Linux, only files reported by inotify are inspected, the whole dir
+ *  is scanned only at startup and when events were lost.
  *  on PDP are no highresolution timestamps. Instead the image maintains a list of changed blocks,
  *  for each of these blocks the DOS-11 file system driver determines the changed file.
  *
@@ -64,8 +81,16 @@
 #include <fcntl.h>
 #include <dirent.h>
 #include <utime.h>
+#include <pthread.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#define HOSTDIR_INOTIFY
+#endif
 
 #include "error.h"
 #include "utils.h"
@@ -89,21 +114,138 @@
 // 1: no actual file operations
 int dbg_simulate = 0;
 
+// find slot of "name" in interned string table
+static char **snapshot_name_slot(hostdir_snapshot_t *_this, char *name) {
+	uint32_t h = strhash(name, STRHASH_INIT);
+	char **slot;
+	// linear probing. Table never full
+	while (*(slot = &_this->name[h & (_this->name_size - 1)]) && strcmp(*slot, name))
+		h++;
+	return slot;
+}
+
+// return the stored copy of "name", add it if new.
+// Interned names are compared by pointer
+static char *snapshot_name_intern(hostdir_snapshot_t *_this, char *name) {
+	char **slot;
+	if (2 * (_this->name_count + 1) > _this->name_size) {
+		// grow: rehash all names
+		char **old = _this->name;
+		unsigned i, old_size = _this->name_size;
+		_this->name_size = old_size ? 2 * old_size : 256;
+		_this->name = calloc(_this->name_size, sizeof(char *));
+		for (i = 0; i < old_size; i++)
+			if (old[i])
+				*snapshot_name_slot(_this, old[i]) = old[i];
+		free(old);
+	}
+	slot = snapshot_name_slot(_this, name);
+	if (!*slot) {
+		*slot = strdup(name);
+		_this->name_count++;
+	}
+	return *slot;
+}
+
+// free all names not used by a file[] entry
+static void snapshot_name_collect(hostdir_snapshot_t *_this) {
+	char **old = _this->name;
+	unsigned i, old_size = _this->name_size;
+	int j;
+	_this->name = calloc(_this->name_size, sizeof(char *));
+	_this->name_count = 0;
+	for (j = 0; j < _this->file_count; j++) {
+		hostdir_file_t *f = &_this->file[j];
+		char **slot = snapshot_name_slot(_this, f->pdp_filnam_ext_stream);
+		if (!*slot)
+			_this->name_count++;
+		*slot = f->pdp_filnam_ext_stream;
+		slot = snapshot_name_slot(_this, f->hostfilename);
+		if (!*slot)
+			_this->name_count++;
+		*slot = f->hostfilename;
+	}
+	for (i = 0; i < old_size; i++)
+		if (old[i] && *snapshot_name_slot(_this, old[i]) != old[i])
+			free(old[i]);
+	free(old);
+}
+
+// enter file[idx] into the name index
+static void snapshot_hash_insert(hostdir_snapshot_t *_this, int idx) {
+	uint32_t h = strhash(_this->file[idx].pdp_filnam_ext_stream, STRHASH_INIT);
+	while (_this->file_hash[h & (_this->file_hash_size - 1)] >= 0)
+		h++; // linear probing
+	_this->file_hash[h & (_this->file_hash_size - 1)] = idx;
+}
+
+// rebuild the name index after file[] was reordered or has grown
+static void snapshot_hash_rebuild(hostdir_snapshot_t *_this) {
+	int i;
+	if (!_this->file_hash_size || _this->file_hash_size < 2 * (unsigned)_this->file_capacity) {
+		_this->file_hash_size = 256;
+		while (_this->file_hash_size < 2 * (unsigned)_this->file_capacity)
+			_this->file_hash_size *= 2;
+		_this->file_hash = realloc(_this->file_hash, _this->file_hash_size * sizeof(int));
+	}
+	memset(_this->file_hash, 0xff, _this->file_hash_size * sizeof(int)); // all -1
+	for (i = 0; i < _this->file_count; i++)
+		snapshot_hash_insert(_this, i);
+}
+
+// append an empty entry to file[], grow if needed.
+// Pointers to other entries get invalid!
+static hostdir_file_t *snapshot_file_append(hostdir_snapshot_t *_this) {
+	hostdir_file_t *result;
+	if (_this->file_count >= _this->file_capacity) {
+		_this->file_capacity = _this->file_capacity ? 2 * _this->file_capacity : 64;
+		_this->file = realloc(_this->file, _this->file_capacity * sizeof(hostdir_file_t));
+	}
+	result = &_this->file[_this->file_count++];
+	memset(result, 0, sizeof(hostdir_file_t));
+	result->pdp_filnam_ext_stream = result->hostfilename = snapshot_name_intern(_this, "");
+	return result;
+}
+
+static void snapshot_create(hostdir_snapshot_t *_this, struct hostdir_struct *hostdir) {
+	_this->hostdir = hostdir;
+	_this->file_count = 0;
+	_this->file_capacity = 0;
+	_this->file = NULL;
+	_this->file_hash = NULL;
+	_this->file_hash_size = 0;
+	_this->name = NULL;
+	_this->name_size = 0;
+	_this->name_count = 0;
+	snapshot_hash_rebuild(_this);
+}
+
+static void snapshot_destroy(hostdir_snapshot_t *_this) {
+	unsigned i;
+	for (i = 0; i < _this->name_size; i++)
+		if (_this->name[i])
+			free(_this->name[i]);
+	free(_this->name);
+	free(_this->file_hash);
+	free(_this->file);
+}
+
 // search a file by name,
 // each PDP strem is an own file here
-// if not found, create, add and set to "create"
-// ONLY way to create files!
-// filename
 hostdir_file_t *snapshot_file_find(hostdir_snapshot_t *_this, char *pdp_filename_ext) {
+	uint32_t h = strhash(pdp_filename_ext, STRHASH_INIT);
 	int i;
-	hostdir_file_t *result = NULL;
-	for (i = 0; !result && i < _this->file_count; i++) {
+	while ((i = _this->file_hash[h & (_this->file_hash_size - 1)]) >= 0) {
 		if (!strcasecmp(_this->file[i].pdp_filnam_ext_stream, pdp_filename_ext))
-			result = &_this->file[i]; // found
+			return &_this->file[i]; // found
+		h++;
 	}
-	return result;
+	return NULL;
 }
 
+// if not found, create, add and set to "create"
+// ONLY way to create files!
+// Result is valid until next register
 hostdir_file_t *snapshot_file_register(hostdir_snapshot_t *_this, char *pdp_filename_ext,
 		hostdir_side_t side) {
 	hostdir_file_t *result;
@@ -117,10 +259,13 @@ hostdir_file_t *snapshot_file_register(hostdir_snapshot_t *_this, char *pdp_file
 		result->state[side] = fs_created;
 	}
 	if (!result) {
-		assert(_this->file_count < HOSTDIR_MAX_FILES);
-		result = &_this->file[_this->file_count++];
-		memset(result, 0, sizeof(hostdir_file_t));
-		strcpy(result->pdp_filnam_ext_stream, pdp_filename_ext);
+		int capacity = _this->file_capacity;
+		result = snapshot_file_append(_this);
+		result->pdp_filnam_ext_stream = snapshot_name_intern(_this, pdp_filename_ext);
+		if (capacity != _this->file_capacity)
+			snapshot_hash_rebuild(_this); // file[] has grown
+		else
+			snapshot_hash_insert(_this, _this->file_count - 1);
 		result->state[side] = fs_created;
 		result->state[OTHER_SIDE(side)] = fs_missing;
 	}
@@ -129,7 +274,7 @@ hostdir_file_t *snapshot_file_register(hostdir_snapshot_t *_this, char *pdp_file
 
 // produces a state info like "deleted on host"
 char *state_text(hostdir_side_t side, hostdir_file_state_t state) {
-	static char buff[2][80];
+	static THREAD_LOCAL char buff[2][80];
 	char *statetxt[] = { "unchanged", "missing", "changed", "created" };
 	char *sidetxt[] = { "PDP", "host" };
 	char *result = buff[side]; // static buffer for each side
@@ -153,69 +298,307 @@ static void snapshot_print(hostdir_snapshot_t *_this, FILE *stream, int all) {
 	}
 }
 
-static int snapshot_scan_hostdir(hostdir_t *_this) {
-	int i;
+// 1, if host file content differs from last scan.
+// Content hash is only calculated, if size is same but time differs,
+// and then kept for the next compare.
+static int snapshot_hostfile_changed(hostdir_t *_this, hostdir_file_t *f, struct stat *sb) {
+	char pathbuff[4096];
+	uint64_t hash;
+	int changed;
+	if (f->host_len == sb->st_size && f->host_mtime == STAT_ST_MTIM(*sb).tv_sec
+			&& f->host_mtime_nsec == STAT_ST_MTIM(*sb).tv_nsec)
+		return 0; // not touched
+	if (f->host_len != sb->st_size) {
+		f->host_hash_valid = 0; // new content not known
+		return 1;
+	}
+	sprintf(pathbuff, "%s/%s", _this->path, f->hostfilename);
+	if (file_hash(pathbuff, &hash)) {
+		f->host_hash_valid = 0;
+		return 1;
+	}
+	// no hash yet: content before is unknown
+	changed = !f->host_hash_valid || hash != f->host_hash;
+	f->host_hash = hash;
+	f->host_hash_valid = 1;
+	return changed;
+}
+
+// register a regular host file, or update its state
+// file_to_delete: set, if file maps to a PDP filename already used by other host file
+static void snapshot_scan_hostfile(hostdir_t *_this, char *hostfname, struct stat *sb,
+		char *file_to_delete) {
+	hostdir_file_t *f;
+	// file create on both sides handled
+	char *pdp_filename_ext;
+	// convert to PDP conventions. Then perhaps not unique!
+	pdp_filename_ext = filesystem_filename_from_host(_this->pdp_fs, hostfname, NULL,
+	NULL);
+	// Find entries with same pdp filename, but different host fname.
+	// These are the cases were truncing the hostname leads double PDP name
+	// Delete those hostfiles.
+	f = snapshot_file_register(&_this->snapshot, pdp_filename_ext, side_host);
+	if (strlen(f->hostfilename) && strcasecmp(f->hostfilename, hostfname)
+			&& file_exists(_this->path, f->hostfilename)) {
+		// duplicate PDP file with different hostnames
+		fprintf(ferr,
+				"Host file \"%s\" maps to duplicate PDP filename \"%s\", will be deleted\n",
+				hostfname, pdp_filename_ext);
+		sprintf(file_to_delete, "%s/%s", _this->path, hostfname);
+	} else {
+		f->hostfilename = snapshot_name_intern(&_this->snapshot, hostfname);
+		// several events for one file: keep "changed"
+		if (f->state[side_host] != fs_created) {
+			if (snapshot_hostfile_changed(_this, f, sb))
+				f->state[side_host] = fs_changed;
+			else if (f->state[side_host] == fs_missing)
+				f->state[side_host] = fs_unchanged;
+		}
+		// update to newest state
+		f->host_present = 1;
+		f->host_len = sb->st_size;
+		f->host_mtime = STAT_ST_MTIM(*sb).tv_sec;
+		f->host_mtime_nsec = STAT_ST_MTIM(*sb).tv_nsec;
+	}
+}
+
+// a host file was reported as changed: register it again, or mark as deleted
+// closed: 1 = writer has closed the file
+static void snapshot_rescan_hostfile(hostdir_t *_this, char *hostfname, int closed,
+		char *file_to_delete) {
+	char pathbuff[4096];
 	struct stat sb;
+	hostdir_file_t *f;
+
+	sprintf(pathbuff, "%s/%s", _this->path, hostfname);
+	if (!stat(pathbuff, &sb) && S_ISREG(sb.st_mode)) {
+		snapshot_scan_hostfile(_this, hostfname, &sb, file_to_delete);
+		f = snapshot_file_find(&_this->snapshot,
+				filesystem_filename_from_host(_this->pdp_fs, hostfname, NULL, NULL));
+		if (f && closed)
+			f->host_closed = 1;
+		return;
+	}
+	// gone. Ignore, if the PDP file is linked to another host file
+	f = snapshot_file_find(&_this->snapshot,
+			filesystem_filename_from_host(_this->pdp_fs, hostfname, NULL, NULL));
+	if (f && !strcasecmp(f->hostfilename, hostfname)) {
+		f->host_present = 0;
+		f->state[side_host] = fs_missing;
+	}
+}
+
+// start watching the shared dir for changes.
+// without notification, every sync scans the whole dir
+static void hostdir_notify_open(hostdir_t *_this) {
+#ifdef HOSTDIR_INOTIFY
+	_this->notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_this->notify_fd >= 0) {
+		_this->notify_wd = inotify_add_watch(_this->notify_fd, _this->path,
+		IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+				| IN_DELETE_SELF | IN_MOVE_SELF);
+		if (_this->notify_wd < 0) {
+			close(_this->notify_fd);
+			_this->notify_fd = -1;
+		}
+	}
+	if (_this->notify_fd < 0)
+		warning("Unit %d: Can not watch \"%s\", scanning whole dir on each sync", _this->unit,
+				_this->path);
+#endif
+	_this->notify_rescan = 1; // first scan: all files
+}
+
+static void hostdir_notify_close(hostdir_t *_this) {
+	if (_this->notify_fd >= 0)
+		close(_this->notify_fd);
+	_this->notify_fd = -1;
+	_this->notify_rescan = 1;
+}
+
+// read all pending change events.
+// If rescan is not necessary, all files reported are rescanned.
+static void hostdir_notify_process(hostdir_t *_this, char *file_to_delete) {
+#ifdef HOSTDIR_INOTIFY
+	char buff[16 * 1024] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	ssize_t n;
+	char *p;
+
+	while (_this->notify_fd >= 0 && (n = read(_this->notify_fd, buff, sizeof(buff))) > 0) {
+		for (p = buff; p < buff + n; p += sizeof(struct inotify_event) + ev->len) {
+			ev = (const struct inotify_event *) p;
+			if (ev->mask & IN_Q_OVERFLOW)
+				_this->notify_rescan = 1; // events lost
+			else if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+				// watch is gone: fall back to full scans
+				hostdir_notify_close(_this);
+				break;
+			} else if (ev->len && !_this->notify_rescan)
+				snapshot_rescan_hostfile(_this, (char *) ev->name,
+						(ev->mask & IN_CLOSE_WRITE) != 0, file_to_delete);
+		}
+	}
+#else
+	UNUSED(file_to_delete);
+#endif
+}
+
+// list the regular files in the shared dir, if not already done in this tick.
+// d_type avoids a stat() for subdirs, "." and "..", names are relative to the dir fd
+static int hostdir_dirlist_scan(hostdir_t *_this) {
 	DIR *dfd;
 	struct dirent *dp;
-	char pathbuff[4096];
-	char file_to_delete[4096];
-	hostdir_file_t *f;
+	struct stat sb;
+	int i, fd;
 
-	// set all files "deleted", found files are overwritten with other state
-	// only deleted files remain "deleted"
-	for (i = 0; i < _this->snapshot.file_count; i++)
-		_this->snapshot.file[i].state[side_host] = fs_missing;
+	if (_this->dirlist_valid)
+		return ERROR_OK;
+	for (i = 0; i < _this->dirlist_count; i++)
+		free(_this->dirlist[i].name);
+	_this->dirlist_count = 0;
+	_this->dirlist_strange = 0;
 
-	dfd = opendir(_this->path); // error checking done, compact code
-	// make list of regular files
-	file_to_delete[0] = 0;
+	if ((dfd = opendir(_this->path)) == NULL)
+		return error_set(ERROR_HOSTDIR, "Unit %d: Can't open \"%s\"", _this->unit, _this->path);
+	fd = dirfd(dfd);
 	while ((dp = readdir(dfd))) {
-		sprintf(pathbuff, "%s/%s", _this->path, dp->d_name);
-		// beware of . and .., not regular file
-		if (stat(pathbuff, &sb))
-			break;
-		if (S_ISREG(sb.st_mode)) {
-			// file create on both sides handled
-			char *pdp_filename_ext;
-			// convert to PDP conventions. Then perhaps not unique!
-			pdp_filename_ext = filesystem_filename_from_host(_this->pdp_fs, dp->d_name, NULL,
-			NULL);
-			// Find entries with same pdp filename, but different host fname.
-			// These are the cases were truncing the hostname leads double PDP name
-			// Delete those hostfiles.
-			f = snapshot_file_register(&_this->snapshot, pdp_filename_ext, side_host);
-			if (strlen(f->hostfilename) && strcasecmp(f->hostfilename, dp->d_name)
-					&& file_exists(_this->path, f->hostfilename)) {
-				// duplicate PDP file with different hostnames
-				fprintf(ferr,
-						"Host file \"%s\" maps to duplicate PDP filename \"%s\", will be deleted\n",
-						dp->d_name, pdp_filename_ext);
-				strcpy(file_to_delete, pathbuff);
-			} else {
-				strcpy(f->hostfilename, dp->d_name);
-				if (f->state[side_host] != fs_created) {
-					if (f->host_len != sb.st_size || f->host_mtime != STAT_ST_MTIM(sb).tv_sec)
-						f->state[side_host] = fs_changed;
-					else
-						f->state[side_host] = fs_unchanged;
-				}
-				// update to newest state
-				f->host_len = sb.st_size;
-				f->host_mtime = STAT_ST_MTIM(sb).tv_sec;
-			}
+		if (!strcmp(dp->d_name, ".") || !strcmp(dp->d_name, ".."))
+			continue;
+		// DT_UNKNOWN on some file systems, symlinks are followed
+		if (dp->d_type != DT_REG && dp->d_type != DT_LNK && dp->d_type != DT_UNKNOWN) {
+			_this->dirlist_strange++;
+			continue;
+		}
+		if (fstatat(fd, dp->d_name, &sb, 0) || !S_ISREG(sb.st_mode)) {
+			_this->dirlist_strange++; // can not access something inside?
+			continue;
 		}
+		if (_this->dirlist_count >= _this->dirlist_capacity) {
+			_this->dirlist_capacity = _this->dirlist_capacity ? 2 * _this->dirlist_capacity : 256;
+			_this->dirlist = realloc(_this->dirlist,
+					_this->dirlist_capacity * sizeof(hostdir_dirent_t));
+		}
+		_this->dirlist[_this->dirlist_count].name = strdup(dp->d_name);
+		_this->dirlist[_this->dirlist_count].sb = sb;
+		_this->dirlist_count++;
 	}
 	closedir(dfd);
+	_this->dirlist_valid = 1;
+	return ERROR_OK;
+}
+
+// Changes seen on host are held back, until the file was not written
+// for opt_quiettime_ms or its writer closed it.
+// So a file still being copied is not imported, several changes give one update.
+static void snapshot_host_settle(hostdir_t *_this) {
+	uint64_t now = now_ms();
+	int i;
+	for (i = 0; i < _this->snapshot.file_count; i++) {
+		hostdir_file_t *f = &_this->snapshot.file[i];
+		hostdir_file_state_t *state = &f->state[side_host];
+		if (*state == fs_changed || *state == fs_created) {
+			// new change in this scan: restart quiet period. "created" stays "created"
+			if (f->host_pending != fs_created)
+				f->host_pending = *state;
+			f->host_change_ms = now;
+		} else if (*state == fs_missing)
+			f->host_pending = fs_unchanged; // deleted: no reason to wait
+		else if (f->host_pending != fs_unchanged)
+			*state = f->host_pending; // still not imported: report again
+		f->host_settling = 0;
+		if (f->host_pending != fs_unchanged) {
+			if (!f->host_closed && now - f->host_change_ms < (uint64_t) opt_quiettime_ms)
+				f->host_settling = 1;
+			else
+				f->host_pending = fs_unchanged; // quiet: import now
+		}
+		f->host_closed = 0;
+	}
+}
+
+// update the host side of the snapshot.
+// with notification only the files reported as changed are inspected,
+// else the whole dir is scanned.
+static int snapshot_scan_hostdir(hostdir_t *_this) {
+	int i;
+	char file_to_delete[4096];
+
+	file_to_delete[0] = 0;
+	if (_this->notify_fd >= 0 && !_this->notify_rescan) {
+		// files not reported keep their state from last scan
+		for (i = 0; i < _this->snapshot.file_count; i++) {
+			hostdir_file_t *f = &_this->snapshot.file[i];
+			f->state[side_host] = f->host_present ? fs_unchanged : fs_missing;
+		}
+		hostdir_notify_process(_this, file_to_delete);
+		// writes give no event before close: sample files still settling again,
+		// so an ongoing copy restarts their quiet time
+		for (i = 0; !_this->notify_rescan && i < _this->snapshot.file_count; i++) {
+			hostdir_file_t *f = &_this->snapshot.file[i];
+			if (f->host_settling && f->state[side_host] == fs_unchanged)
+				snapshot_rescan_hostfile(_this, f->hostfilename, 0, file_to_delete);
+		}
+	}
+	if (_this->notify_fd < 0 || _this->notify_rescan) {
+		// discard events, covered by full scan
+		hostdir_notify_process(_this, file_to_delete);
+		_this->notify_rescan = 0;
+
+		// set all files "deleted", found files are overwritten with other state
+		// only deleted files remain "deleted"
+		for (i = 0; i < _this->snapshot.file_count; i++) {
+			_this->snapshot.file[i].state[side_host] = fs_missing;
+			_this->snapshot.file[i].host_present = 0;
+		}
+		hostdir_dirlist_scan(_this);
+		for (i = 0; i < _this->dirlist_count; i++)
+			snapshot_scan_hostfile(_this, _this->dirlist[i].name, &_this->dirlist[i].sb,
+					file_to_delete);
+	}
+	snapshot_host_settle(_this);
 	// delete only one hostfile per round ... in fact a whole file list should be maintained
-	if (strlen(file_to_delete))
+	if (strlen(file_to_delete)) {
 		unlink(file_to_delete);
+		_this->dirlist_valid = 0;
+	}
 	return ERROR_OK;
 }
 
+// unmap host files borrowed by pdp_fs streams
+static void hostdir_mapping_release(hostdir_t *_this) {
+	int i;
+	for (i = 0; i < _this->mapping_count; i++)
+		munmap(_this->mapping[i].addr, _this->mapping[i].len);
+	free(_this->mapping);
+	_this->mapping = NULL;
+	_this->mapping_count = 0;
+}
+
+// count of 512 byte blocks in the PDP image
+static unsigned hostdir_image_blockcount(hostdir_t *_this) {
+	return NEEDED_BLOCKS(512, _this->pdp_fs->image_data_size);
+}
+
+// clear pdp_fs, then it no longer references mapped host files
+static void hostdir_pdp_fs_init(hostdir_t *_this) {
+	filesystem_init(_this->pdp_fs);
+	hostdir_mapping_release(_this);
+	_this->pdp_fs_parsed = 0;
+}
+
+// 1: image was not written since pdp_fs was parsed, parse result still valid
+static int hostdir_pdp_fs_current(hostdir_t *_this) {
+	filesystem_t *fs = _this->pdp_fs;
+	if (!_this->pdp_fs_parsed || !fs->changedblocks)
+		return 0;
+	return boolarray_is_empty(fs->changedblocks, hostdir_image_blockcount(_this));
+}
+
 // register all files in the PDP file system
 static int snapshot_scan_pdpimage(hostdir_t *_this) {
 	int i, j;
+	int unchanged = 0;
 	hostdir_file_t *f;
 
 	// see above
@@ -225,11 +608,15 @@ static int snapshot_scan_pdpimage(hostdir_t *_this) {
 	// not expandle, we're only creating
 	// filesystem_create(_this->fs, _this->dec_device, &_this->image_data, &_this->image_data_size,/*expandable*/0) ;
 
-	filesystem_init(_this->pdp_fs);
-
-	// analyse an image
-	if (filesystem_parse(_this->pdp_fs))
-		return error_set(error_code, "Uint %d: Scanning PDP image", _this->unit);
+	if (hostdir_pdp_fs_current(_this))
+		unchanged = 1; // no PDP write since last parse: files as before
+	else {
+		hostdir_pdp_fs_init(_this);
+		// analyse an image
+		if (filesystem_parse(_this->pdp_fs))
+			return error_set(error_code, "Uint %d: Scanning PDP image", _this->unit);
+		_this->pdp_fs_parsed = 1;
+	}
 	// if PDP file system was created with block change map, now changed files are marked
 	for (i = -FILESYSTEM_MAX_SPECIALFILE_COUNT; i < *_this->pdp_fs->file_count; i++) {
 		file_t *fpdp = filesystem_file_get(_this->pdp_fs, i); // include bootblock & monitor
@@ -243,7 +630,7 @@ static int snapshot_scan_pdpimage(hostdir_t *_this) {
 				f->pdp_fixed = fpdp->fixed;
 				f->pdp_streamidx = j;
 				if (f->state[side_pdp] != fs_created) {
-					if (fpdp->stream[j].changed)
+					if (fpdp->stream[j].changed && !unchanged)
 						f->state[side_pdp] = fs_changed;
 					else
 						f->state[side_pdp] = fs_unchanged;
@@ -253,6 +640,22 @@ static int snapshot_scan_pdpimage(hostdir_t *_this) {
 	return ERROR_OK;
 }
 
+// remove files which exist on neither side
+static void snapshot_compact(hostdir_t *_this) {
+	int i, j;
+	for (i = j = 0; i < _this->snapshot.file_count; i++) {
+		hostdir_file_t *f = &_this->snapshot.file[i];
+		if (f->state[side_pdp] == fs_missing && f->state[side_host] == fs_missing)
+			continue;
+		if (i != j)
+			_this->snapshot.file[j] = *f;
+		j++;
+	}
+	_this->snapshot.file_count = j;
+	snapshot_hash_rebuild(&_this->snapshot);
+	snapshot_name_collect(&_this->snapshot);
+}
+
 // clear all "change" states on both sides
 static int snapshot_clear_states(hostdir_t *_this) {
 	int i;
@@ -264,10 +667,11 @@ static int snapshot_clear_states(hostdir_t *_this) {
 }
 
 // init the hostdir snapshot from PDP and hostdir
+// host side is updated incrementally, if change notification is active
 static void snapshot_init(hostdir_t *_this) {
-	_this->snapshot.file_count = 0;
 	snapshot_scan_hostdir(_this);
 	snapshot_scan_pdpimage(_this);
+	snapshot_compact(_this);
 	snapshot_clear_states(_this);
 	// now both sides "unchanged"
 }
@@ -281,9 +685,7 @@ static void snapshot_init(hostdir_t *_this) {
  */
 int hostdir_prepare(hostdir_t *_this, int wipe, int allowcreate, int *created) {
 	struct stat sb;
-	struct dirent *dp;
-	DIR *dfd;
-	int ok;
+	int i, ok;
 	char pathbuff[4096];
 	FILE *f;
 
@@ -308,25 +710,8 @@ int hostdir_prepare(hostdir_t *_this, int wipe, int allowcreate, int *created) {
 	if (stat(_this->path, &sb) || !S_ISDIR(sb.st_mode))
 		return error_set(ERROR_HOSTDIR, "Unit %d: \"%s\" is no directory", _this->unit, _this->path);
 
-	// has it subdirs? iterate through
-	if ((dfd = opendir(_this->path)) == NULL)
-		return error_set(ERROR_HOSTDIR, "Unit %d: Can't open \"%s\"", _this->unit, _this->path);
-
-	ok = 1;
-	while (ok && (dp = readdir(dfd)) != NULL) {
-		sprintf(pathbuff, "%s/%s", _this->path, dp->d_name);
-		if (stat(pathbuff, &sb))
-			ok = 0; // can not access something inside?
-		else if (strcmp(dp->d_name, ".") && strcmp(dp->d_name, "..") && !S_ISREG(sb.st_mode))
-			// only regular files and . and .. allowed
-			ok = 0;
-	}
-	closedir(dfd);
-	if (!ok)
-		return error_set(ERROR_HOSTDIR, "Unit %d: Dir \"%s\" contains subdirs or strange stuff\n", _this->unit,
-				_this->path);
-
 	// can I write to it?
+	ok = 1;
 	sprintf(pathbuff, "%s/_tu58_file_test_", _this->path);
 	f = fopen(pathbuff, "w");
 	if (!f)
@@ -343,17 +728,22 @@ int hostdir_prepare(hostdir_t *_this, int wipe, int allowcreate, int *created) {
 	sprintf(pathbuff, "%s/%s", _this->path, "$VOLUM.INF");
 	remove(pathbuff);
 
+	// has it subdirs? Only regular files allowed.
+	// Listing is reused by following scans
+	_this->dirlist_valid = 0;
+	if (hostdir_dirlist_scan(_this))
+		return error_code;
+	if (_this->dirlist_strange)
+		return error_set(ERROR_HOSTDIR, "Unit %d: Dir \"%s\" contains subdirs or strange stuff\n", _this->unit,
+				_this->path);
+
 	// delete content
 	if (wipe) {
-		dfd = opendir(_this->path); // error checking done, compact code
-		while ((dp = readdir(dfd))) {
-			sprintf(pathbuff, "%s/%s", _this->path, dp->d_name);
-			// beware of . and ..
-			if (stat(pathbuff, &sb))
-				break;
-			if (S_ISREG(sb.st_mode))
-				remove(pathbuff);
+		for (i = 0; i < _this->dirlist_count; i++) {
+			sprintf(pathbuff, "%s/%s", _this->path, _this->dirlist[i].name);
+			remove(pathbuff);
 		}
+		_this->dirlist_valid = 0;
 	}
 
 	return ERROR_OK;
@@ -371,7 +761,9 @@ int hostdir_from_pdp_fs(hostdir_t *_this) {
 	for (fileidx = -FILESYSTEM_MAX_SPECIALFILE_COUNT; fileidx < *_this->pdp_fs->file_count;
 			fileidx++) {
 		int i;
-		file_t *f = filesystem_file_get(_this->pdp_fs, fileidx);
+		file_t *f;
+		filesystem_file_load(_this->pdp_fs, fileidx);
+		f = filesystem_file_get(_this->pdp_fs, fileidx);
 		if (f)
 			for (i = 0; i < FILESYSTEM_MAX_DATASTREAM_COUNT; i++)
 				if (f->stream[i].valid) {
@@ -380,6 +772,7 @@ int hostdir_from_pdp_fs(hostdir_t *_this) {
 							filesystem_filename_to_host(_this->pdp_fs, f->filnam, f->ext,
 									stream->name));
 					file_write(pathbuff, stream->data, stream->data_size);
+					_this->dirlist_valid = 0;
 					if (fileidx >= 0) {
 						// regular file, not bootblock or monitor: set original file date
 						ut.modtime = mktime(&f->date);
@@ -391,73 +784,395 @@ int hostdir_from_pdp_fs(hostdir_t *_this) {
 	return ERROR_OK;
 }
 
-// add a file to the PDP filesystem
-static int pdp_fs_file_add(hostdir_t *_this, filesystem_t *fs, char *fpath, char *fname) {
+// read a host file into a new allocated buffer.
+// Used by ingest threads, so no error_set(): result NULL = OK, else failed operation
+static char *hostfile_load(char *pathbuff, struct stat *sb, uint8_t **data,
+		unsigned *data_size) {
+	unsigned n;
+	ssize_t res;
+	int fd;
+
+	fd = open(pathbuff, O_RDONLY);
+	if (fd < 0)
+		return "open";
+	if (fstat(fd, sb)) {
+		close(fd);
+		return "get statistics for";
+	}
+	// use stat size of the opened file to allocate data buffer
+	*data_size = sb->st_size;
+	*data = malloc(*data_size + 1);
+	for (n = 0; n < *data_size; n += res) {
+		res = pread(fd, *data + n, *data_size - n, n);
+		if (res <= 0)
+			break; // error, or truncated meanwhile
+	}
+	close(fd);
+	if (n != *data_size) {
+		free(*data);
+		return "read all bytes from";
+	}
+	return NULL;
+}
+
+/*
+ * Only settled read-only host files are mapped, others are read as copies.
+ * Still a mapped file truncated on the host raises SIGBUS on access
+ * to the lost pages. Mapped data is accessed only by the thread running
+ * hostdir_image_reload() (render).
+ * There the access is guarded: SIGBUS jumps back to the guard, which
+ * reads the files again as copies. Resources of the interrupted code leak.
+ * The handler is installed once per process, other SIGBUS go to the handler before.
+ */
+static THREAD_LOCAL sigjmp_buf *hostfile_sigbus_jmp; // != NULL: guarded access running
+static struct sigaction hostfile_sigbus_prev; // handler before ours
+static pthread_once_t hostfile_sigbus_once = PTHREAD_ONCE_INIT;
+
+static void hostfile_sigbus_handler(int sig, siginfo_t *info, void *context) {
+	if (hostfile_sigbus_jmp)
+		siglongjmp(*hostfile_sigbus_jmp, 1);
+	// not from a mapped host file: chain
+	if (hostfile_sigbus_prev.sa_flags & SA_SIGINFO)
+		hostfile_sigbus_prev.sa_sigaction(sig, info, context);
+	else if (hostfile_sigbus_prev.sa_handler == SIG_DFL) {
+		sigaction(sig, &hostfile_sigbus_prev, NULL);
+		raise(sig);
+	} else if (hostfile_sigbus_prev.sa_handler != SIG_IGN)
+		hostfile_sigbus_prev.sa_handler(sig);
+}
+
+static void hostfile_sigbus_install(void) {
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = hostfile_sigbus_handler;
+	sa.sa_flags = SA_SIGINFO;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGBUS, &sa, &hostfile_sigbus_prev);
+}
+
+// host files not written for this time may be mapped
+#define HOSTFILE_MAP_SETTLED_SEC	60
+
+// 1, if a host file is unlikely to change while mapped:
+// no write permission and not modified lately
+static int hostfile_mappable(struct stat *sb) {
+	time_t age = time(NULL) - STAT_ST_MTIM(*sb).tv_sec;
+	if (sb->st_mode & (S_IWUSR | S_IWGRP | S_IWOTH))
+		return 0; // may be written
+	return age >= HOSTFILE_MAP_SETTLED_SEC && (uint64_t) age * 1000 >= (uint64_t) opt_quiettime_ms;
+}
+
+// map a host file read-only into memory, see hostfile_sigbus_handler().
+// Empty, unsettled or writable files or failed mmap(): fallback to hostfile_load(), *mapped = 0
+static char *hostfile_map(char *pathbuff, struct stat *sb, uint8_t **data,
+		unsigned *data_size, int *mapped) {
+	void *addr;
+	int fd;
+
+	*mapped = 0;
+	fd = open(pathbuff, O_RDONLY);
+	if (fd < 0)
+		return "open";
+	if (fstat(fd, sb)) {
+		close(fd);
+		return "get statistics for";
+	}
+	addr = MAP_FAILED;
+	if (sb->st_size > 0 && hostfile_mappable(sb))
+		addr = mmap(NULL, sb->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // mapping stays valid
+	if (addr == MAP_FAILED)
+		return hostfile_load(pathbuff, sb, data, data_size);
+	*data = addr;
+	*data_size = sb->st_size;
+	*mapped = 1;
+	return NULL;
+}
+
+// read a host file into a new allocated buffer
+static int hostfile_read(hostdir_t *_this, char *fpath, char *fname, struct stat *sb,
+		uint8_t **data, unsigned *data_size) {
 	char pathbuff[4096];
+	char *failed;
+
+	sprintf(pathbuff, "%s/%s", fpath, fname);
+	failed = hostfile_load(pathbuff, sb, data, data_size);
+	if (failed)
+		return error_set(ERROR_HOSTFILE, "Unit %d: Can not %s \"%s\"", _this->unit, failed,
+				pathbuff);
+	return ERROR_OK;
+}
+
+// content of a host file was read into the PDP image:
+// remember sampled size and time. A content hash of the scan stays valid,
+// if the file did not change since.
+static void snapshot_hostfile_ingested(hostdir_t *_this, char *hostfname, struct stat *sb) {
+	char *pdp_filename_ext = filesystem_filename_from_host(_this->pdp_fs, hostfname, NULL,
+	NULL);
+	hostdir_file_t *f = snapshot_file_find(&_this->snapshot, pdp_filename_ext);
+	if (!f) {
+		// not yet scanned: register like the scan would do
+		f = snapshot_file_register(&_this->snapshot, pdp_filename_ext, side_host);
+		f->hostfilename = snapshot_name_intern(&_this->snapshot, hostfname);
+	}
+	if (strcasecmp(f->hostfilename, hostfname))
+		return; // duplicate PDP name, handled by scan
+	if (f->host_len != sb->st_size || f->host_mtime != STAT_ST_MTIM(*sb).tv_sec
+			|| f->host_mtime_nsec != STAT_ST_MTIM(*sb).tv_nsec)
+		f->host_hash_valid = 0;
+	f->host_present = 1;
+	f->host_len = sb->st_size;
+	f->host_mtime = STAT_ST_MTIM(*sb).tv_sec;
+	f->host_mtime_nsec = STAT_ST_MTIM(*sb).tv_nsec;
+}
+
+/*
+ * Ingest: host files are read by a pool of threads,
+ * but added to the PDP filesystem in the given order,
+ * so the layout is deterministic.
+ */
+#define HOSTDIR_INGEST_THREADS	4
+
+typedef struct {
+	char *fname;
 	struct stat sb;
 	uint8_t *data;
-	unsigned data_size, n;
-	FILE *f;
+	unsigned data_size;
+	int mapped; // 1: data[] is mapped, else malloc'd
+	char *failed; // see hostfile_load()
+	int done; // 1: read by worker
+} hostdir_ingest_file_t;
 
-	sprintf(pathbuff, "%s/%s", fpath, fname);
-	if (stat(pathbuff, &sb))
-		return error_set(ERROR_HOSTFILE, "Unit %d: Can get statistics for \"%s\"", _this->unit, pathbuff);
+typedef struct {
+	char *path;
+	int nomap; // 1: load files as copies
+	hostdir_ingest_file_t *file;
+	int file_count;
+	int next_file; // next to read by a worker
+	pthread_mutex_t mutex;
+	pthread_cond_t file_done;
+} hostdir_ingest_t;
 
-	f = fopen(pathbuff, "r");
-	if (!f)
-		return error_set(ERROR_HOSTFILE, "Unit %d: Can not open \"%s\"", _this->unit, pathbuff);
-	// use stat size to allocate data buffer
-	data_size = sb.st_size;
-	data = malloc(data_size);
-	n = fread(data, 1, data_size, f);
-	fclose(f);
+static void *hostdir_ingest_worker(void *arg) {
+	hostdir_ingest_t *ingest = arg;
+	hostdir_ingest_file_t *f;
+	char pathbuff[4096];
+	char *failed;
+	int i;
 
-	if (n != data_size)
-		return error_set(ERROR_HOSTFILE, "Unit %d: Read %d bytes instead of %d from \"%s\"", _this->unit, n,
-				data_size, pathbuff);
+	for (;;) {
+		pthread_mutex_lock(&ingest->mutex);
+		i = ingest->next_file++;
+		pthread_mutex_unlock(&ingest->mutex);
+		if (i >= ingest->file_count)
+			return NULL;
+		f = &ingest->file[i];
+		sprintf(pathbuff, "%s/%s", ingest->path, f->fname);
+		if (ingest->nomap) {
+			f->mapped = 0;
+			failed = hostfile_load(pathbuff, &f->sb, &f->data, &f->data_size);
+		} else
+			failed = hostfile_map(pathbuff, &f->sb, &f->data, &f->data_size, &f->mapped);
 
-	// add to filesystem
-	filesystem_file_add(fs, fname, STAT_ST_MTIM(sb).tv_sec, sb.st_mode, data, data_size);
+		pthread_mutex_lock(&ingest->mutex);
+		f->failed = failed;
+		f->done = 1;
+		pthread_cond_broadcast(&ingest->file_done);
+		pthread_mutex_unlock(&ingest->mutex);
+	}
+}
 
-	free(data);
-	return ERROR_OK;
+// read files names[] and add them to the PDP filesystem, in that order
+static int hostdir_ingest(hostdir_t *_this, char **names, int filecount) {
+	pthread_t thread[HOSTDIR_INGEST_THREADS];
+	int thread_count;
+	hostdir_ingest_t ingest;
+	int i;
+	int result = ERROR_OK;
+
+	ingest.path = _this->path;
+	ingest.nomap = _this->hostfile_nomap;
+	ingest.file = calloc(filecount + 1, sizeof(hostdir_ingest_file_t));
+	ingest.file_count = filecount;
+	ingest.next_file = 0;
+	for (i = 0; i < filecount; i++)
+		ingest.file[i].fname = names[i];
+	_this->mapping = realloc(_this->mapping,
+			(_this->mapping_count + filecount) * sizeof(hostdir_mapping_t));
+	pthread_mutex_init(&ingest.mutex, NULL);
+	pthread_cond_init(&ingest.file_done, NULL);
+
+	for (thread_count = 0; thread_count < HOSTDIR_INGEST_THREADS && thread_count < filecount;
+			thread_count++)
+		if (pthread_create(&thread[thread_count], NULL, hostdir_ingest_worker, &ingest))
+			break;
+	if (thread_count == 0)
+		hostdir_ingest_worker(&ingest); // no threads: read all here
+
+	for (i = 0; i < filecount; i++) {
+		hostdir_ingest_file_t *f = &ingest.file[i];
+		pthread_mutex_lock(&ingest.mutex);
+		while (!f->done)
+			pthread_cond_wait(&ingest.file_done, &ingest.mutex);
+		pthread_mutex_unlock(&ingest.mutex);
+		if (f->failed) {
+			if (result == ERROR_OK)
+				result = error_set(ERROR_HOSTFILE, "Unit %d: Can not %s \"%s/%s\"", _this->unit,
+						f->failed, _this->path, f->fname);
+			continue;
+		}
+		if (result == ERROR_OK) {
+			snapshot_hostfile_ingested(_this, f->fname, &f->sb);
+			// add to filesystem. Mapped data is not copied, but rendered
+			// directly from the mapping into the image
+			filesystem_file_add(_this->pdp_fs, f->fname, STAT_ST_MTIM(f->sb).tv_sec,
+					f->sb.st_mode, f->data, f->data_size, f->mapped);
+		}
+		if (f->mapped) {
+			// keep until next hostdir_pdp_fs_init(), also on error: pdp_fs may reference it
+			hostdir_mapping_t *m = &_this->mapping[_this->mapping_count++];
+			m->addr = f->data;
+			m->len = f->data_size;
+		} else
+			free(f->data);
+	}
+
+	for (i = 0; i < thread_count; i++)
+		pthread_join(thread[i], NULL);
+	pthread_cond_destroy(&ingest.file_done);
+	pthread_mutex_destroy(&ingest.mutex);
+	free(ingest.file);
+	return result;
+}
+
+/*
+ * Hot file counters: PDP read/write commands are counted per image block.
+ * On each sync the block counts are added to the files owning the blocks.
+ * With opt_hotlayout, files are ordered by these counts on image reload.
+ */
+
+// enter hotfile[idx] into the name index
+static void hostdir_hotfile_hash_insert(hostdir_t *_this, int idx) {
+	uint32_t h = strhash(_this->hotfile[idx].hostfilename, STRHASH_INIT);
+	while (_this->hotfile_hash[h & (_this->hotfile_hash_size - 1)] >= 0)
+		h++; // linear probing
+	_this->hotfile_hash[h & (_this->hotfile_hash_size - 1)] = idx;
+}
+
+// rebuild the name index after hotfile[] has grown
+static void hostdir_hotfile_hash_rebuild(hostdir_t *_this) {
+	int i;
+	_this->hotfile_hash_size = 256;
+	while (_this->hotfile_hash_size < 2 * (unsigned) _this->hotfile_capacity)
+		_this->hotfile_hash_size *= 2;
+	_this->hotfile_hash = realloc(_this->hotfile_hash, _this->hotfile_hash_size * sizeof(int));
+	memset(_this->hotfile_hash, 0xff, _this->hotfile_hash_size * sizeof(int)); // all -1
+	for (i = 0; i < _this->hotfile_count; i++)
+		hostdir_hotfile_hash_insert(_this, i);
+}
+
+// counter of a host file. create: add a new 0 entry, if not found
+static hostdir_hotfile_t *hostdir_hotfile_get(hostdir_t *_this, char *hostfilename, int create) {
+	uint32_t h = strhash(hostfilename, STRHASH_INIT);
+	int i;
+	if (_this->hotfile_hash)
+		while ((i = _this->hotfile_hash[h & (_this->hotfile_hash_size - 1)]) >= 0) {
+			if (!strcasecmp(_this->hotfile[i].hostfilename, hostfilename))
+				return &_this->hotfile[i]; // found
+			h++;
+		}
+	if (!create)
+		return NULL;
+	if (_this->hotfile_count >= _this->hotfile_capacity) {
+		_this->hotfile_capacity = _this->hotfile_capacity ? 2 * _this->hotfile_capacity : 64;
+		_this->hotfile = realloc(_this->hotfile,
+				_this->hotfile_capacity * sizeof(hostdir_hotfile_t));
+	}
+	_this->hotfile[_this->hotfile_count].hostfilename = strdup(hostfilename);
+	_this->hotfile[_this->hotfile_count].count = 0;
+	_this->hotfile_count++;
+	if (_this->hotfile_hash_size < 2 * (unsigned) _this->hotfile_capacity)
+		hostdir_hotfile_hash_rebuild(_this); // hotfile[] has grown
+	else
+		hostdir_hotfile_hash_insert(_this, _this->hotfile_count - 1);
+	return &_this->hotfile[_this->hotfile_count - 1];
+}
+
+// add block accesses since last sync to the files.
+// A file counts as often as its most used block was accessed.
+// pdp_fs must be a parse of the current image.
+static void hostdir_hotfiles_collect(hostdir_t *_this) {
+	unsigned blknr;
+	int *owner;
+	uint32_t *file_access;
+	int file_count = *_this->pdp_fs->file_count;
+	int i;
+
+	if (!_this->blockaccess || file_count <= 0)
+		return;
+	owner = malloc(_this->blockaccess_count * sizeof(int));
+	file_access = calloc(file_count, sizeof(uint32_t));
+	filesystem_block_owners(_this->pdp_fs, owner, _this->blockaccess_count);
+	for (blknr = 0; blknr < _this->blockaccess_count; blknr++) {
+		i = owner[blknr];
+		if (i >= 0 && _this->blockaccess[blknr] > file_access[i])
+			file_access[i] = _this->blockaccess[blknr];
+	}
+	for (i = 0; i < file_count; i++)
+		if (file_access[i]) {
+			file_t *f = filesystem_file_get(_this->pdp_fs, i);
+			hostdir_hotfile_t *hf = hostdir_hotfile_get(_this,
+					filesystem_filename_to_host(_this->pdp_fs, f->filnam, f->ext, NULL), 1);
+			if (hf->count > UINT32_MAX - file_access[i])
+				hf->count = UINT32_MAX; // saturate
+			else
+				hf->count += file_access[i];
+		}
+	memset(_this->blockaccess, 0, _this->blockaccess_count * sizeof(uint32_t));
+	free(file_access);
+	free(owner);
 }
 
 // scan all files, add into filesystem in correct order
 // recognizes monitor and bootblock
 int hostdir_to_pdp_fs(hostdir_t *_this) {
-	char pathbuff[4096];
-	char *names[10000];
+	char **names;
+	uint32_t *hotness = NULL;
 	int filecount;
-	// load filenames
-	// delete content
-	struct stat sb;
-	DIR *dfd;
-	struct dirent *dp;
 	int i;
+	int result;
 
-	dfd = opendir(_this->path); // error checking done, compact code
-	filecount = 0;
-	// make list of regular files
-	while ((dp = readdir(dfd))) {
-		sprintf(pathbuff, "%s/%s", _this->path, dp->d_name);
-		// beware of . and ..
-		if (stat(pathbuff, &sb))
-			break;
-		if (S_ISREG(sb.st_mode)) {
-			names[filecount++] = strdup(dp->d_name);
-		}
+	// list of regular files
+	if (hostdir_dirlist_scan(_this))
+		return error_set(error_code, "Unit %d: Host dir to PDP filesystem", _this->unit);
+	names = malloc((_this->dirlist_count + 1) * sizeof(char *));
+	for (filecount = i = 0; i < _this->dirlist_count; i++) {
+		char *name = _this->dirlist[i].name; // valid until next scan
+		hostdir_file_t *f = snapshot_file_find(&_this->snapshot,
+				filesystem_filename_from_host(_this->pdp_fs, name, NULL, NULL));
+		if (f && f->host_settling && !strcasecmp(f->hostfilename, name))
+			continue; // still written, imported in a later sync
+		names[filecount++] = name;
 	}
 
-	// sort names[] according to filesystem order
-	filename_sort(names, filecount, filesystem_fileorder(_this->pdp_fs), -1);
+	// sort names[] according to filesystem order, frequently used first
+	if (opt_hotlayout) {
+		hotness = malloc((filecount + 1) * sizeof(uint32_t));
+		for (i = 0; i < filecount; i++) {
+			hostdir_hotfile_t *hf = hostdir_hotfile_get(_this, names[i], 0);
+			hotness[i] = hf ? hf->count : 0;
+		}
+	}
+	filename_sort(names, filecount, filesystem_fileorder(_this->pdp_fs), -1, hotness);
+	if (hotness)
+		free(hotness);
 
 	// add all files
-	filesystem_init(_this->pdp_fs);
-	for (i = 0; i < filecount; i++) {
-		if (pdp_fs_file_add(_this, _this->pdp_fs, _this->path, names[i]))
-			return error_set(error_code, "Unit %d: Host dir to PDP filesystem", _this->unit);
-	}
+	hostdir_pdp_fs_init(_this);
+	result = hostdir_ingest(_this, names, filecount);
+	free(names);
+	if (result)
+		return error_set(error_code, "Unit %d: Host dir to PDP filesystem", _this->unit);
 
 	return ERROR_OK;
 }
@@ -468,23 +1183,81 @@ hostdir_t *hostdir_create(int unit, char *path, filesystem_t *pdp_fs) {
 	hostdir_t *_this;
 	_this = malloc(sizeof(hostdir_t));
 	_this->unit = unit ;
-	strcpy(_this->path, path);
+	_this->path = strdup(path);
 	_this->pdp_fs = pdp_fs;
 
-	_this->snapshot.hostdir = _this ;
-	_this->snapshot.file_count = 0;
+	snapshot_create(&_this->snapshot, _this);
+	_this->notify_fd = -1;
+	_this->notify_rescan = 1;
+	_this->mapping = NULL;
+	_this->mapping_count = 0;
+	_this->pdp_fs_parsed = 0;
+	_this->touched = boolarray_create(hostdir_image_blockcount(_this));
+	_this->hostfile_nomap = 0;
+	pthread_once(&hostfile_sigbus_once, hostfile_sigbus_install);
+	_this->dirlist = NULL;
+	_this->dirlist_count = 0;
+	_this->dirlist_capacity = 0;
+	_this->dirlist_valid = 0;
+	_this->blockaccess = NULL;
+	_this->blockaccess_count = 0;
+	_this->hotfile = NULL;
+	_this->hotfile_count = 0;
+	_this->hotfile_capacity = 0;
+	_this->hotfile_hash = NULL;
+	_this->hotfile_hash_size = 0;
 	return _this;
 }
 
 void hostdir_destroy(hostdir_t *_this) {
+	int i;
+	hostdir_notify_close(_this);
+	hostdir_mapping_release(_this);
+	snapshot_destroy(&_this->snapshot);
+	for (i = 0; i < _this->dirlist_count; i++)
+		free(_this->dirlist[i].name);
+	free(_this->dirlist);
+	for (i = 0; i < _this->hotfile_count; i++)
+		free(_this->hotfile[i].hostfilename);
+	free(_this->hotfile);
+	free(_this->hotfile_hash);
+	boolarray_destroy(_this->touched);
+	free(_this->path);
 	free(_this);
 }
 
+// count of blocks in _this->touched
+static unsigned hostdir_touched_count(hostdir_t *_this) {
+	unsigned blknr, result = 0;
+	for (blknr = 0; blknr < hostdir_image_blockcount(_this); blknr++)
+		result += BOOLARRAY_BIT_GET(_this->touched, blknr);
+	return result;
+}
+
 // init image with content of existing hostdir files
+// rewritten blocks are added to _this->touched
 static int hostdir_image_reload(hostdir_t *_this) {
-	filesystem_init(_this->pdp_fs);
+	sigjmp_buf sigbus_jmp;
+
+	hostdir_pdp_fs_init(_this);
 	hostdir_to_pdp_fs(_this); //  dir => filesystem
-	filesystem_render(_this->pdp_fs); // filesystem => image
+	// render reads mapped host files
+	if (sigsetjmp(sigbus_jmp, 1) == 0) {
+		hostfile_sigbus_jmp = &sigbus_jmp;
+		filesystem_render(_this->pdp_fs, _this->touched); // filesystem => image
+	} else {
+		hostfile_sigbus_jmp = NULL;
+		warning("Unit %d: Host file truncated while read, reloading without mapping.",
+				_this->unit);
+		_this->hostfile_nomap = 1;
+		hostdir_to_pdp_fs(_this);
+		filesystem_render(_this->pdp_fs, _this->touched);
+		_this->hostfile_nomap = 0;
+	}
+	hostfile_sigbus_jmp = NULL;
+	if (opt_verbose)
+		info("Unit %d: Rendered %u changed blocks into PDP image.", _this->unit,
+				hostdir_touched_count(_this));
 	if (opt_debug)
 		filesystem_print_dir(_this->pdp_fs, ferr);
 	if (opt_debug)
@@ -494,9 +1267,332 @@ static int hostdir_image_reload(hostdir_t *_this) {
 	return ERROR_OK;
 }
 
+// write files changed on host into the parsed PDP image, without new layout.
+// deletes first, to free space for the updates.
+// ERROR_FILESYSTEM_OVERFLOW: layout must change, image must be reloaded
+// rewritten blocks are added to _this->touched
+static int hostdir_pdp_fs_update(hostdir_t *_this) {
+	boolarray_t *touched = _this->touched;
+	int i, pass;
+	int result = ERROR_OK;
+
+	_this->pdp_fs_parsed = 0; // parse again in next sync
+	for (pass = 0; result == ERROR_OK && pass < 2; pass++)
+		for (i = 0; result == ERROR_OK && i < _this->snapshot.file_count; i++) {
+			hostdir_file_t *f = &_this->snapshot.file[i];
+			if (!f->pdp_update)
+				continue;
+			if (f->state[side_host] == fs_missing) {
+				if (pass == 0)
+					result = filesystem_file_delete(_this->pdp_fs, f->pdp_filnam_ext_stream,
+							touched);
+			} else if (pass == 1) {
+				struct stat sb;
+				uint8_t *data;
+				unsigned data_size;
+				char *hostfname = f->hostfilename; // interned, stays valid
+				result = hostfile_read(_this, _this->path, hostfname, &sb, &data, &data_size);
+				if (result == ERROR_OK) {
+					snapshot_hostfile_ingested(_this, hostfname, &sb);
+					result = filesystem_file_update(_this->pdp_fs, hostfname,
+							STAT_ST_MTIM(sb).tv_sec, sb.st_mode, data, data_size, touched);
+					free(data);
+				}
+			}
+		}
+
+	if (result == ERROR_OK && opt_verbose)
+		info("Unit %d: Updated %u blocks in PDP image.", _this->unit, hostdir_touched_count(_this));
+	return result;
+}
+
+/*
+ * Manifest: snapshot and image are saved next to the shared dir on close.
+ * On next load they replace the rebuild from all host files,
+ * if the dir still is as recorded.
+ * Layout, all numbers little endian:
+ *	header: magic[8], fs_type, device_type, image_size, file_count, names_size (32 bit)
+ *	file_count entries: pdp name offset, host name offset (32 bit), size (64),
+ *		mtime sec (64), mtime nsec (32), content hash (64), flags (32)
+ *	names: names_size bytes of 0-terminated names, offsets are relative to its start
+ *	image: image_size bytes
+ */
+#define HOSTDIR_MANIFEST_MAGIC	"TU58FS03"
+#define HOSTDIR_MANIFEST_HEADER_SIZE	28
+#define HOSTDIR_MANIFEST_ENTRY_SIZE	40
+#define HOSTDIR_MANIFEST_HASH_VALID	0x01 // entry flag
+
+typedef struct {
+	char magic[8];
+	uint32_t fs_type;
+	uint32_t device_type;
+	uint32_t image_size;
+	uint32_t file_count;
+	uint32_t names_size;
+} hostdir_manifest_header_t;
+
+// store "bytes" of val little endian at *p, advance *p
+static void hostdir_manifest_put(uint8_t **p, uint64_t val, int bytes) {
+	while (bytes--) {
+		*(*p)++ = val & 0xff;
+		val >>= 8;
+	}
+}
+
+// fetch "bytes" little endian from *p, advance *p
+static uint64_t hostdir_manifest_get(uint8_t **p, int bytes) {
+	uint64_t val = 0;
+	int i;
+	for (i = 0; i < bytes; i++)
+		val |= (uint64_t) *(*p)++ << (8 * i);
+	return val;
+}
+
+// "<path><suffix>", file next to the shared dir
+static char *hostdir_sidefile_path(hostdir_t *_this, char *suffix) {
+	static THREAD_LOCAL char buff[4096 + 16];
+	int n;
+	strcpy(buff, _this->path);
+	// strip trailing "/"
+	while ((n = strlen(buff)) > 1 && buff[n - 1] == '/')
+		buff[n - 1] = 0;
+	strcat(buff, suffix);
+	return buff;
+}
+
+// "<path>.tu58fs"
+static char *hostdir_manifest_path(hostdir_t *_this) {
+	return hostdir_sidefile_path(_this, ".tu58fs");
+}
+
+static void hostdir_manifest_header_init(hostdir_t *_this, hostdir_manifest_header_t *hdr) {
+	memset(hdr, 0, sizeof(*hdr));
+	memcpy(hdr->magic, HOSTDIR_MANIFEST_MAGIC, sizeof(hdr->magic));
+	hdr->fs_type = _this->pdp_fs->type;
+	hdr->device_type = _this->pdp_fs->device_type;
+	hdr->image_size = _this->pdp_fs->image_data_size;
+}
+
+// files on host only. $VOLUM.INF is produced again on each load
+static int hostdir_manifest_entry_saved(hostdir_file_t *sf) {
+	return sf->host_present && strcasecmp(sf->hostfilename, "$VOLUM.INF");
+}
+
+// save snapshot and image. Call after last sync.
+int hostdir_manifest_save(hostdir_t *_this) {
+	hostdir_manifest_header_t hdr;
+	char *path = hostdir_manifest_path(_this);
+	uint8_t *buff, *p, *names;
+	unsigned buff_size;
+	FILE *f;
+	int i, ok;
+
+	hostdir_manifest_header_init(_this, &hdr);
+	for (i = 0; i < _this->snapshot.file_count; i++) {
+		hostdir_file_t *sf = &_this->snapshot.file[i];
+		if (sf->host_pending != fs_unchanged)
+			return error_set(ERROR_HOSTDIR, NULL); // image misses a host change
+		if (hostdir_manifest_entry_saved(sf)) {
+			hdr.file_count++;
+			hdr.names_size += strlen(sf->pdp_filnam_ext_stream) + 1
+					+ strlen(sf->hostfilename) + 1;
+		}
+	}
+	// header, entries and names are built in memory
+	buff_size = HOSTDIR_MANIFEST_HEADER_SIZE + hdr.file_count * HOSTDIR_MANIFEST_ENTRY_SIZE
+			+ hdr.names_size;
+	buff = malloc(buff_size);
+	p = buff;
+	memcpy(p, hdr.magic, sizeof(hdr.magic));
+	p += sizeof(hdr.magic);
+	hostdir_manifest_put(&p, hdr.fs_type, 4);
+	hostdir_manifest_put(&p, hdr.device_type, 4);
+	hostdir_manifest_put(&p, hdr.image_size, 4);
+	hostdir_manifest_put(&p, hdr.file_count, 4);
+	hostdir_manifest_put(&p, hdr.names_size, 4);
+	names = p + hdr.file_count * HOSTDIR_MANIFEST_ENTRY_SIZE;
+	for (i = 0; i < _this->snapshot.file_count; i++) {
+		hostdir_file_t *sf = &_this->snapshot.file[i];
+		if (!hostdir_manifest_entry_saved(sf))
+			continue;
+		hostdir_manifest_put(&p, names - (buff + buff_size - hdr.names_size), 4);
+		strcpy((char *) names, sf->pdp_filnam_ext_stream);
+		names += strlen(sf->pdp_filnam_ext_stream) + 1;
+		hostdir_manifest_put(&p, names - (buff + buff_size - hdr.names_size), 4);
+		strcpy((char *) names, sf->hostfilename);
+		names += strlen(sf->hostfilename) + 1;
+		hostdir_manifest_put(&p, (uint64_t) sf->host_len, 8);
+		hostdir_manifest_put(&p, (uint64_t) sf->host_mtime, 8);
+		hostdir_manifest_put(&p, (uint64_t) sf->host_mtime_nsec, 4);
+		hostdir_manifest_put(&p, sf->host_hash, 8);
+		hostdir_manifest_put(&p, sf->host_hash_valid ? HOSTDIR_MANIFEST_HASH_VALID : 0, 4);
+	}
+
+	f = fopen(path, "w");
+	if (!f) {
+		free(buff);
+		return error_set(ERROR_HOSTFILE, "Unit %d: Can not write manifest \"%s\"", _this->unit,
+				path);
+	}
+	ok = fwrite(buff, 1, buff_size, f) == buff_size;
+	ok = ok && fwrite(_this->pdp_fs->image_data, 1, _this->pdp_fs->image_data_size, f)
+			== _this->pdp_fs->image_data_size;
+	free(buff);
+	if (fclose(f) || !ok) {
+		remove(path);
+		return error_set(ERROR_HOSTFILE, "Unit %d: Can not write manifest \"%s\"", _this->unit,
+				path);
+	}
+	if (opt_verbose)
+		info("Unit %d: Saved manifest \"%s\".", _this->unit, path);
+	return ERROR_OK;
+}
+
+// "<path>.tu58hot": text lines "<count> <hostfilename>"
+static void hostdir_hotfiles_load(hostdir_t *_this) {
+	char line[4096 + 32];
+	char *path = hostdir_sidefile_path(_this, ".tu58hot");
+	FILE *f;
+	unsigned count;
+	int n;
+
+	f = fopen(path, "r");
+	if (!f)
+		return; // no counters yet
+	while (fgets(line, sizeof(line), f)) {
+		// strip line end
+		n = strlen(line);
+		while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r'))
+			line[--n] = 0;
+		if (sscanf(line, "%u %n", &count, &n) == 1 && line[n])
+			hostdir_hotfile_get(_this, line + n, 1)->count = count;
+	}
+	fclose(f);
+}
+
+// save access counters of all files. Call on close
+int hostdir_hotfiles_save(hostdir_t *_this) {
+	char *path = hostdir_sidefile_path(_this, ".tu58hot");
+	FILE *f;
+	int i;
+
+	if (_this->hotfile_count == 0)
+		return ERROR_OK;
+	f = fopen(path, "w");
+	if (!f)
+		return error_set(ERROR_HOSTFILE, "Unit %d: Can not write access counters \"%s\"",
+				_this->unit, path);
+	for (i = 0; i < _this->hotfile_count; i++)
+		fprintf(f, "%u %s\n", _this->hotfile[i].count, _this->hotfile[i].hostfilename);
+	if (fclose(f))
+		return error_set(ERROR_HOSTFILE, "Unit %d: Can not write access counters \"%s\"",
+				_this->unit, path);
+	return ERROR_OK;
+}
+
+// load snapshot and image from manifest, if host dir is unchanged.
+// The manifest is valid only once, so a crash never reuses an old one.
+// ERROR_OK: image and snapshot valid
+static int hostdir_manifest_load(hostdir_t *_this) {
+	hostdir_manifest_header_t hdr, hdr_expected;
+	char *path = hostdir_manifest_path(_this);
+	struct stat sb;
+	uint8_t *buff, *p, *names;
+	uint64_t size;
+	uint32_t pdp_name, host_name;
+	FILE *f;
+	unsigned i;
+	int valid;
+
+	f = fopen(path, "r");
+	if (!f)
+		return error_set(ERROR_HOSTFILE, NULL); // silent: no manifest
+	remove(path);
+
+	hostdir_manifest_header_init(_this, &hdr_expected);
+	memset(&hdr, 0, sizeof(hdr));
+	buff = malloc(HOSTDIR_MANIFEST_HEADER_SIZE);
+	valid = !fstat(fileno(f), &sb)
+			&& fread(buff, 1, HOSTDIR_MANIFEST_HEADER_SIZE, f) == HOSTDIR_MANIFEST_HEADER_SIZE;
+	if (valid) {
+		p = buff;
+		memcpy(hdr.magic, p, sizeof(hdr.magic));
+		p += sizeof(hdr.magic);
+		hdr.fs_type = hostdir_manifest_get(&p, 4);
+		hdr.device_type = hostdir_manifest_get(&p, 4);
+		hdr.image_size = hostdir_manifest_get(&p, 4);
+		hdr.file_count = hostdir_manifest_get(&p, 4);
+		hdr.names_size = hostdir_manifest_get(&p, 4);
+		hdr_expected.file_count = hdr.file_count;
+		hdr_expected.names_size = hdr.names_size;
+		valid = !memcmp(&hdr, &hdr_expected, sizeof(hdr));
+	}
+	// counts must describe exactly the file
+	size = HOSTDIR_MANIFEST_HEADER_SIZE + (uint64_t) hdr.file_count * HOSTDIR_MANIFEST_ENTRY_SIZE
+			+ hdr.names_size + hdr.image_size;
+	valid = valid && size == (uint64_t) sb.st_size;
+	size = (uint64_t) hdr.file_count * HOSTDIR_MANIFEST_ENTRY_SIZE + hdr.names_size;
+	if (valid) {
+		buff = realloc(buff, size + 1);
+		valid = fread(buff, 1, size, f) == size;
+	}
+	// last name must be terminated, then all names in the block are
+	names = buff + hdr.file_count * HOSTDIR_MANIFEST_ENTRY_SIZE;
+	valid = valid && (hdr.names_size ? names[hdr.names_size - 1] == 0 : hdr.file_count == 0);
+	_this->snapshot.file_count = 0;
+	p = buff;
+	for (i = 0; valid && i < hdr.file_count; i++) {
+		hostdir_file_t *sf;
+		pdp_name = hostdir_manifest_get(&p, 4);
+		host_name = hostdir_manifest_get(&p, 4);
+		valid = pdp_name < hdr.names_size && host_name < hdr.names_size;
+		if (!valid)
+			break;
+		sf = snapshot_file_append(&_this->snapshot);
+		sf->pdp_filnam_ext_stream = snapshot_name_intern(&_this->snapshot,
+				(char *) names + pdp_name);
+		sf->hostfilename = snapshot_name_intern(&_this->snapshot, (char *) names + host_name);
+		sf->host_present = 1;
+		sf->host_len = (off_t) hostdir_manifest_get(&p, 8);
+		sf->host_mtime = (time_t) hostdir_manifest_get(&p, 8);
+		sf->host_mtime_nsec = (long) hostdir_manifest_get(&p, 4);
+		sf->host_hash = hostdir_manifest_get(&p, 8);
+		sf->host_hash_valid = !!(hostdir_manifest_get(&p, 4) & HOSTDIR_MANIFEST_HASH_VALID);
+	}
+	free(buff);
+	if (!valid)
+		_this->snapshot.file_count = 0;
+	snapshot_hash_rebuild(&_this->snapshot);
+
+	if (valid) {
+		// all recorded files still there and not touched, no new ones?
+		_this->notify_rescan = 1;
+		snapshot_scan_hostdir(_this);
+		for (i = 0; valid && i < _this->snapshot.file_count; i++)
+			valid = _this->snapshot.file[i].state[side_host] == fs_unchanged;
+	}
+	if (valid)
+		valid = fread(_this->pdp_fs->image_data, 1, _this->pdp_fs->image_data_size, f)
+				== _this->pdp_fs->image_data_size;
+	fclose(f);
+
+	if (!valid) {
+		_this->snapshot.file_count = 0;
+		snapshot_hash_rebuild(&_this->snapshot);
+		_this->notify_rescan = 1;
+		return error_set(ERROR_HOSTDIR, NULL);
+	}
+	snapshot_init(_this);
+	if (opt_verbose)
+		info("Unit %d: Image restored from manifest \"%s\".", _this->unit, path);
+	return ERROR_OK;
+}
+
 // load all files from hostdir into image
 // former content of image is lost
 int hostdir_load(hostdir_t *_this, int allowcreate, int *created) {
+	_this->dirlist_valid = 0; // new tick
+	boolarray_clear(_this->touched);
 
 	if (hostdir_prepare(_this, /*wipe*/0, allowcreate, created)) {
 		error("Unit %d: hostdir_prepare() failed", _this->unit);
@@ -505,6 +1601,15 @@ int hostdir_load(hostdir_t *_this, int allowcreate, int *created) {
 	if (opt_verbose && *created)
 		info("Unit %d: Host directory \"%s\" created", _this->unit, _this->path);
 
+	// watch before first scan, so no change is lost
+	hostdir_notify_open(_this);
+
+	hostdir_hotfiles_load(_this);
+
+	// warm start from last session, if dir not changed.
+	// Not with hot file layout: order may have changed with the counters
+	if (!opt_hotlayout && !hostdir_manifest_load(_this))
+		return ERROR_OK;
 	return hostdir_image_reload(_this);
 }
 
@@ -513,7 +1618,7 @@ int hostdir_load(hostdir_t *_this, int allowcreate, int *created) {
 int hostdir_save(hostdir_t *_this) {
 	if (hostdir_prepare(_this, /*wipe*/1, 0, NULL))
 		return error_set(error_code, "Unit %d: Saving host dir", _this->unit);
-	filesystem_init(_this->pdp_fs);
+	hostdir_pdp_fs_init(_this);
 	filesystem_parse(_this->pdp_fs); // image => filesystem
 	hostdir_from_pdp_fs(_this); // filesystem => dir
 	if (opt_debug)
@@ -527,14 +1632,24 @@ int hostdir_save(hostdir_t *_this) {
 // may copy several files, if PDP file has several streams
 static void hostdir_file_copy_from_pdp(hostdir_t *_this, hostdir_file_t *f) {
 	char pathbuff[4096];
+	struct stat sb;
 	file_t *fpdp;
 	file_stream_t *stream;
 	sprintf(pathbuff, "%s/%s", _this->path, f->pdp_filnam_ext_stream);
 
+	filesystem_file_load(_this->pdp_fs, f->pdp_fileidx);
 	fpdp = filesystem_file_get(_this->pdp_fs, f->pdp_fileidx); // also boot and monitor
 	stream = &fpdp->stream[f->pdp_streamidx];
 	if (!dbg_simulate)
 		file_write(pathbuff, stream->data, stream->data_size);
+	_this->dirlist_valid = 0;
+	// written state is the new base, so it is not imported back
+	if (!dbg_simulate && !stat(pathbuff, &sb)) {
+		f->host_len = sb.st_size;
+		f->host_mtime = STAT_ST_MTIM(sb).tv_sec;
+		f->host_mtime_nsec = STAT_ST_MTIM(sb).tv_nsec;
+		f->host_hash_valid = 0;
+	}
 	if (opt_verbose)
 		info("Unit %d: Copied file \"%s\" from PDP to shared dir.", _this->unit, pathbuff);
 }
@@ -545,6 +1660,7 @@ static void hostdir_file_delete(hostdir_t *_this, hostdir_file_t *f) {
 	sprintf(pathbuff, "%s/%s", _this->path, f->hostfilename);
 	if (!dbg_simulate)
 		remove(pathbuff);
+	_this->dirlist_valid = 0;
 	if (opt_verbose)
 		info("Unit %d: Deleted file \"%s\" on shared dir.", _this->unit, pathbuff);
 }
@@ -558,10 +1674,13 @@ int hostdir_sync(hostdir_t *_this) {
 	// as PDP filesystem and hostdir where synched
 
 	// scan hostdir
+	_this->dirlist_valid = 0; // new tick
+	boolarray_clear(_this->touched);
 	snapshot_scan_hostdir(_this);
 
 	// scan PDP image
 	snapshot_scan_pdpimage(_this);
+	hostdir_hotfiles_collect(_this);
 
 	// print state
 	if (opt_debug)
@@ -590,6 +1709,9 @@ int hostdir_sync(hostdir_t *_this) {
 		// not readonly: update hostdir and PDP file system
 		for (i = 0; i < _this->snapshot.file_count; i++) {
 			hostdir_file_t *f = &_this->snapshot.file[i];
+			f->pdp_update = 0;
+			if (f->host_settling)
+				continue; // host file still written: next sync
 			// 16 cases. The cases when one side is unchanged are easy
 			if (f->state[side_pdp] == fs_unchanged && f->state[side_host] == fs_unchanged) {
 				// do nothing
@@ -598,13 +1720,13 @@ int hostdir_sync(hostdir_t *_this) {
 				if (f->pdp_fixed)
 					hostdir_file_copy_from_pdp(_this, f); // restore
 				else
-					update_pdp = 1; // update PDP from hostdir
+					update_pdp = f->pdp_update = 1; // update PDP from hostdir
 			} else if (f->state[side_pdp] == fs_unchanged
 					&& f->state[side_host] == fs_changed) {
-				update_pdp = 1; // update PDP from hostdir
+				update_pdp = f->pdp_update = 1; // update PDP from hostdir
 			} else if (f->state[side_pdp] == fs_unchanged
 					&& f->state[side_host] == fs_created) {
-				update_pdp = 1; // update PDP from hostdir
+				update_pdp = f->pdp_update = 1; // update PDP from hostdir
 
 			} else if (f->state[side_pdp] == fs_missing
 					&& f->state[side_host] == fs_unchanged) {
@@ -617,11 +1739,11 @@ int hostdir_sync(hostdir_t *_this) {
 				if (_this->pdp_priority)
 					hostdir_file_delete(_this, f);
 				else
-					update_pdp = 1;
+					update_pdp = f->pdp_update = 1;
 				update_snapshot = 1;
 			} else if (f->state[side_pdp] == fs_missing && f->state[side_host] == fs_created) {
 				// the file was created on host and is not yet on PDP
-				update_pdp = 1; // force reload
+				update_pdp = f->pdp_update = 1; // force reload
 			} else if (f->state[side_pdp] == fs_changed
 					&& f->state[side_host] == fs_unchanged) {
 				hostdir_file_copy_from_pdp(_this, f);
@@ -630,19 +1752,19 @@ int hostdir_sync(hostdir_t *_this) {
 				if (f->pdp_fixed || _this->pdp_priority)
 					hostdir_file_copy_from_pdp(_this, f);
 				else
-					update_pdp = 1;
+					update_pdp = f->pdp_update = 1;
 				update_snapshot = 1;
 			} else if (f->state[side_pdp] == fs_changed && f->state[side_host] == fs_changed) {
 				if (_this->pdp_priority)
 					hostdir_file_copy_from_pdp(_this, f);
 				else
-					update_pdp = 1;
+					update_pdp = f->pdp_update = 1;
 				update_snapshot = 1;
 			} else if (f->state[side_pdp] == fs_changed && f->state[side_host] == fs_created) {
 				if (_this->pdp_priority)
 					hostdir_file_copy_from_pdp(_this, f);
 				else
-					update_pdp = 1;
+					update_pdp = f->pdp_update = 1;
 				update_snapshot = 1;
 			} else if (f->state[side_pdp] == fs_created
 					&& f->state[side_host] == fs_unchanged) {
@@ -656,13 +1778,13 @@ int hostdir_sync(hostdir_t *_this) {
 				if (_this->pdp_priority)
 					hostdir_file_copy_from_pdp(_this, f);
 				else
-					update_pdp = 1;
+					update_pdp = f->pdp_update = 1;
 				update_snapshot = 1;
 			} else if (f->state[side_pdp] == fs_created && f->state[side_host] == fs_created) {
 				if (_this->pdp_priority)
 					hostdir_file_copy_from_pdp(_this, f);
 				else
-					update_pdp = 1;
+					update_pdp = f->pdp_update = 1;
 				update_snapshot = 1;
 			}
 		}
@@ -670,8 +1792,12 @@ int hostdir_sync(hostdir_t *_this) {
 	if (update_pdp) {
 		hostdir_file_t *f;
 		// files in the host dir have changed:
-		// reload the tu58 image
-		hostdir_image_reload(_this);
+		// update them in the tu58 image, reload if layout must change
+		if (hostdir_pdp_fs_update(_this)) {
+			if (opt_verbose)
+				info("Unit %d: Changes do not fit into PDP image, reloading.", _this->unit);
+			hostdir_image_reload(_this);
+		}
 		// send volum.inf (RT11)
 		f = snapshot_file_find(&_this->snapshot, "$VOLUM.INF");
 		if (f)
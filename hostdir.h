@@ -33,15 +33,16 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026  JH  access counters for hot file layout
  *  20-Jan-2017  JH  created
  */
 
 #ifndef _HOSTDIR_H_
 #define _HOSTDIR_H_
 
+#include <sys/stat.h>
 #include "filesystem.h"
 
-#define HOSTDIR_MAX_FILES	1000
 #define HOSTDIR_MAX_FILENAMELEN	40 // normally only 6.3 used
 
 typedef enum {
@@ -59,39 +60,107 @@ typedef enum {
 // is a PDP file stream
 typedef struct {
 	// identifying: the PDP filename
-	char pdp_filnam_ext_stream[40]; // normally only 6.3 used + streamname
-	char hostfilename[256] ; // also needed: the uncorrected host name
+	// both names are interned in the snapshot, never NULL
+	char *pdp_filnam_ext_stream; // normally only 6.3 used + streamname
+	char *hostfilename ; // also needed: the uncorrected host name. "" if unknown
 
 	// changes on host / PDP side, idx by "side"
 	hostdir_file_state_t state[2];
 
+	int host_present; // 1: file exists in shared dir, as of last scan
 	off_t host_len; // sampled size on host
 	time_t host_mtime; // modification time
+	long host_mtime_nsec; // nano seconds of modification time
+	uint64_t host_hash; // content hash, compared if size is same but time differs
+	int host_hash_valid; // 1: host_hash is known for current content
+	// quiescence: a host file is imported only after it was not written for a while
+	hostdir_file_state_t host_pending; // fs_changed/fs_created not yet imported, else fs_unchanged
+	uint64_t host_change_ms; // time of last change seen on host
+	int host_closed; // 1: writer has closed the file, no need to wait
+	int host_settling; // 1: pending change not yet quiet, skipped in this sync
 
 	int pdp_fileidx; // index in pdp-filesystem
 	int pdp_streamidx; // is the i-th stream of that file
 	int	pdp_fixed ; // 1: is part of pdp filesystem, cann ot be deleted
+	int pdp_update; // 1: host state must be written to PDP image in this sync
 } hostdir_file_t;
 
+// a host file mapped into memory. Its data is borrowed by pdp_fs,
+// until the next filesystem_init()
+typedef struct {
+	void *addr;
+	size_t len;
+} hostdir_mapping_t;
+
+// a regular file in the shared dir, from one directory scan
+typedef struct {
+	char *name;
+	struct stat sb;
+} hostdir_dirent_t;
+
+// PDP accesses to a host file, for hot file layout
+typedef struct {
+	char *hostfilename;
+	uint32_t count;
+} hostdir_hotfile_t;
+
 // state of host dir
 typedef struct {
 	struct hostdir_struct *hostdir ; // uplink
 	int file_count;
-	hostdir_file_t file[HOSTDIR_MAX_FILES];
+	int file_capacity; // allocated entries in file[]
+	hostdir_file_t *file; // grows on demand
+	// index into file[] by pdp_filnam_ext_stream, open addressing. -1 = empty
+	int *file_hash;
+	unsigned file_hash_size; // power of 2, more than 2 * file_count
+	// interned names: each distinct string stored once. NULL = empty slot
+	char **name;
+	unsigned name_size; // power of 2
+	unsigned name_count;
 } hostdir_snapshot_t;
 
 typedef struct hostdir_struct {
 	int	unit ; //  which TU58 device?
-	char path[4096];  // path to host dir
+	char *path;  // path to host dir
 
 	// PDP image
 	filesystem_t *pdp_fs; // link to initialized PDP file system
 	// the fs is linked to the image data buffer
 
+	int pdp_fs_parsed; // 1: pdp_fs is parse of current image, reused while no block changes
+	boolarray_t *touched; // image blocks rewritten by last load or sync
+
 	hostdir_snapshot_t snapshot;
 
+	hostdir_mapping_t *mapping; // host files mapped by hostdir_to_pdp_fs()
+	int mapping_count;
+	int hostfile_nomap; // 1: host files are read as copies, not mapped
+
+	// regular files of last directory scan, shared by prepare, scan and load.
+	// Valid until files are written, or the next load/sync/save starts
+	hostdir_dirent_t *dirlist;
+	int dirlist_count;
+	int dirlist_capacity;
+	int dirlist_strange; // count of subdirs and other non-regular entries
+	int dirlist_valid;
+
+	// host side change notification (inotify on Linux)
+	int notify_fd; // -1: not available, every sync scans whole dir
+	int notify_wd; // watch on path
+	int notify_rescan; // 1: events lost or dir never scanned: full scan needed
+
 	// collision management
 	int pdp_priority ; // 1: file state in PDP image overrides hostdir changes
+
+	// hot file layout. Counters persist in "<path>.tu58hot"
+	uint32_t *blockaccess; // link to image: accesses per block, cleared by sync. may be NULL
+	uint32_t blockaccess_count;
+	hostdir_hotfile_t *hotfile; // grows on demand
+	int hotfile_count;
+	int hotfile_capacity;
+	// index into hotfile[] by hostfilename, open addressing. -1 = empty
+	int *hotfile_hash;
+	unsigned hotfile_hash_size; // power of 2, more than 2 * hotfile_capacity
 } hostdir_t;
 
 hostdir_t *hostdir_create(int unit, char *path, filesystem_t *pdp_fs) ;
@@ -105,5 +174,7 @@ int hostdir_to_pdp_fs(hostdir_t *_this);
 int hostdir_load(hostdir_t *_this, int allowcreate, int *created) ;
 int hostdir_save(hostdir_t *_this) ;
 int hostdir_sync(hostdir_t *_this) ;
+int hostdir_manifest_save(hostdir_t *_this) ;
+int hostdir_hotfiles_save(hostdir_t *_this) ;
 
 #endif /* _HOSTDIR_H_ */
@@ -33,6 +33,13 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026  JH  block access heatmap, sequential access statistics
+ *  18-Oct-2026  JH  block access counters for hot file layout
+ *  18-Oct-2026  JH  image file: filesystem parsed once, save restores patched words
+ *  18-Oct-2026  JH  changed blocks cleared under lock
+ *  18-Oct-2026  JH  sync triggered by PDP directory writes
+ *  18-Oct-2026  JH  access time for per-unit sync
+ *  18-Oct-2026  JH  save hostdir manifest on close
  *  07-May-2017  JH  passes GCC warning levels -Wall -Wextra
  *  20-Jan-2017  JH  created
  *
@@ -102,11 +109,16 @@ image_t *image_create(device_type_t dec_device, int unit, int forced_data_size)
 	image_t *_this;
 	_this = malloc(sizeof(image_t));
 	pthread_mutex_init(&_this->mutex, NULL);
+	pthread_cond_init(&_this->sync_wakeup, NULL);
+	_this->sync_running = 0;
+	_this->sync_stop = 0;
 	_this->open = 0;
 	_this->changed = 0;
 	_this->changedblocks = NULL;
+	_this->accesstime_ms = 0;
 	_this->host_fpath = NULL;
 	_this->pdp_filesystem = NULL;
+	_this->patch_count = 0;
 	_this->hostdir = NULL;
 	_this->dec_filesystem = fsNONE;
 	_this->dec_device = dec_device;
@@ -129,8 +141,16 @@ image_t *image_create(device_type_t dec_device, int unit, int forced_data_size)
 	} else
 		block_count = _this->device_info->block_count;
 	_this->data_size = block_count * _this->blocksize;
-	_this->data = malloc(_this->data_size);
+	_this->data = calloc(1, _this->data_size); // render writes only used blocks
 	_this->changedblocks = boolarray_create(IMAGE_MAX_BLOCKS);
+	_this->metadatablocks = boolarray_create(IMAGE_MAX_BLOCKS);
+	_this->metadata_changed = 0;
+	_this->blockaccess = NULL;
+	_this->blockaccess_count = 0;
+	_this->blockstat = NULL;
+	_this->access_reads = _this->access_writes = _this->access_sequential = 0;
+	_this->access_next_blknr = 0;
+	_this->access_run_blocks = _this->access_run_max = 0;
 
 	return _this;
 }
@@ -143,6 +163,47 @@ static void image_unlock(image_t *_this) {
 	pthread_mutex_unlock(&_this->mutex);
 }
 
+// remember the directory blocks of the PDP filesystem.
+// Call after filesystem was parsed.
+static void image_metadata_update(image_t *_this) {
+	boolarray_clear(_this->metadatablocks);
+	_this->metadata_changed = 0;
+	if (_this->pdp_filesystem)
+		filesystem_metadata_blocks(_this->pdp_filesystem, _this->metadatablocks);
+}
+
+// image file: parse the image, patch it and remember the patched words.
+// Called on open, and on save if the PDP changed directory or patched blocks
+static void image_patch_update(image_t *_this) {
+	filesystem_patch_t tmp;
+	int i, j;
+	filesystem_parse(_this->pdp_filesystem);
+	filesystem_patch(_this->pdp_filesystem); // RT-11: change DD.SYS
+	_this->patch_count = filesystem_patch_list(_this->pdp_filesystem, _this->patch);
+	// sort by offset, for sequential write
+	for (i = 1; i < _this->patch_count; i++)
+		for (j = i; j > 0 && _this->patch[j - 1].offset > _this->patch[j].offset; j--) {
+			tmp = _this->patch[j];
+			_this->patch[j] = _this->patch[j - 1];
+			_this->patch[j - 1] = tmp;
+		}
+	image_metadata_update(_this);
+}
+
+// image file: patch list still valid?
+static int image_patch_valid(image_t *_this) {
+	int i;
+	if (_this->metadata_changed)
+		return 0;
+	// no directory found yet: PDP may have initialized the volume
+	if (boolarray_is_empty(_this->metadatablocks, _this->data_size / _this->blocksize))
+		return 0;
+	for (i = 0; i < _this->patch_count; i++)
+		if (BOOLARRAY_BIT_GET(_this->changedblocks, _this->patch[i].offset / _this->blocksize))
+			return 0;
+	return 1;
+}
+
 // opens image file or creates it
 static int image_hostfile_open(image_t *_this, int allowcreate, int *filecreated) {
 	int32_t fd;		// file descriptor
@@ -192,13 +253,8 @@ static int image_hostfile_open(image_t *_this, int allowcreate, int *filecreated
 		_this->changed = 0; // is in sync with disc file
 
 		/* modify locally, if no empty file */
-		if (_this->dec_filesystem != fsNONE && !is_memset(_this->data, 0, _this->data_size)) {
-			filesystem_t *pdp_fs = filesystem_create(_this->dec_filesystem, _this->dec_device,
-					_this->readonly, _this->data, _this->data_size, NULL);
-			filesystem_parse(pdp_fs);
-			filesystem_patch(pdp_fs); // RT-11: change DD.SYS
-			filesystem_destroy(pdp_fs);
-		}
+		if (_this->pdp_filesystem && !is_memset(_this->data, 0, _this->data_size))
+			image_patch_update(_this);
 
 	} else {
 		// new file created
@@ -209,13 +265,10 @@ static int image_hostfile_open(image_t *_this, int allowcreate, int *filecreated
 			break;
 		case fsXXDP:
 		case fsRT11: {
-			filesystem_t *pdp_fs;
 			// render an empty filesystem into data[]
-			pdp_fs = filesystem_create(_this->dec_filesystem, _this->dec_device,
-					_this->readonly, _this->data, _this->data_size, NULL);
-			if (filesystem_render(pdp_fs))
+			if (filesystem_render(_this->pdp_filesystem, NULL))
 				return error_set(error_code, "Creating empty file system");
-			filesystem_destroy(pdp_fs);
+			image_metadata_update(_this);
 			info("Unit %d: initialize empty %s file system on \"%s\"", _this->unit,
 					filesystem_name(_this->dec_filesystem), _this->host_fpath);
 		}
@@ -235,24 +288,27 @@ static int image_hostfile_open(image_t *_this, int allowcreate, int *filecreated
 // write image to file
 static int image_hostfile_save(image_t *_this) {
 	int32_t fd;		// file descriptor
+	uint32_t pos;
+	int i;
 	fd = open(_this->host_fpath, O_BINARY | O_RDWR, 0666);
 	if (fd < 0)
 		return error_set(ERROR_HOSTFILE, "Unit %d: image_save cannot open \"%s\"", _this->unit,
 				_this->host_fpath);
 
-	/* undo local changes, save, restore local changes */
-	if (_this->dec_filesystem != fsNONE) {
-		filesystem_t *pdp_fs = filesystem_create(_this->dec_filesystem, _this->dec_device,
-				_this->readonly, _this->data, _this->data_size, NULL);
-		filesystem_parse(pdp_fs);
-		filesystem_unpatch(pdp_fs); // RT-11: restore DD.SYS
-
-		write(fd, _this->data, _this->data_size);
-
-		filesystem_patch(pdp_fs); // RT-11: change DD.SYS
-		filesystem_destroy(pdp_fs);
-	} else
-		write(fd, _this->data, _this->data_size);
+	// PDP may have moved or rewritten DD.SYS: parse again
+	if (_this->pdp_filesystem && !image_patch_valid(_this))
+		image_patch_update(_this);
+
+	/* save with original words at patched positions, image stays patched */
+	pos = 0;
+	for (i = 0; i < _this->patch_count; i++) {
+		filesystem_patch_t *patch = &_this->patch[i];
+		uint8_t word[2] = { patch->original & 0xff, (patch->original >> 8) & 0xff };
+		write(fd, _this->data + pos, patch->offset - pos);
+		write(fd, word, 2);
+		pos = patch->offset + 2;
+	}
+	write(fd, _this->data + pos, _this->data_size - pos);
 	close(fd);
 	return 0;
 }
@@ -274,12 +330,23 @@ int image_open(image_t *_this, int shared, int readonly, int allowcreate, char *
 
 		if (hostdir_load(_this->hostdir, allowcreate, &filecreated))
 			return error_set(error_code, "Opening shared directory");
+		image_metadata_update(_this);
 		// data and data_size may have been enlarged !
+		_this->blockaccess_count = _this->data_size / _this->blocksize;
+		_this->blockaccess = calloc(_this->blockaccess_count, sizeof(uint32_t));
+		_this->hostdir->blockaccess = _this->blockaccess;
+		_this->hostdir->blockaccess_count = _this->blockaccess_count;
 	} else {
+		_this->blockaccess_count = _this->data_size / _this->blocksize;
+		// parsed filesystem kept for save
+		if (dec_filesystem != fsNONE)
+			_this->pdp_filesystem = filesystem_create(dec_filesystem, _this->dec_device,
+					_this->readonly, _this->data, _this->data_size, NULL);
 		// also initializes new tape
 		if (image_hostfile_open(_this, allowcreate, &filecreated))
 			return error_set(error_code, "Opening image file");
 	}
+	_this->blockstat = calloc(_this->blockaccess_count, sizeof(image_blockstat_t));
 	_this->seekpos = 0;
 	_this->open = 1;
 
@@ -361,6 +428,7 @@ int image_read(image_t *_this, void *buf, int32_t count) {
 	src = _this->data + _this->seekpos;
 	memcpy(buf, src, count);
 	_this->seekpos += count;
+	_this->accesstime_ms = now_ms();
 
 	image_unlock(_this);
 	return count;
@@ -389,17 +457,127 @@ int image_write(image_t *_this, void *buf, int32_t count) {
 	// set dirty
 	_this->changed = 1;
 	_this->changetime_ms = now_ms();
+	_this->accesstime_ms = _this->changetime_ms;
 	// mark all block in range
 	for (blknr = _this->seekpos / _this->blocksize;
-			blknr < (_this->seekpos + count) / _this->blocksize; blknr++)
+			blknr < (_this->seekpos + count) / _this->blocksize; blknr++) {
 		boolarray_bit_set(_this->changedblocks, blknr);
+		if (BOOLARRAY_BIT_GET(_this->metadatablocks, blknr)) {
+			// directory written: new files to export soon
+			_this->metadata_changed = 1;
+			_this->metadata_changetime_ms = _this->changetime_ms;
+		}
+	}
 	// boolarray_print_diag(_this->changedblocks, stderr, _this->block_count, "IMAGE");
 	_this->seekpos += count;
+	pthread_cond_broadcast(&_this->sync_wakeup); // sync worker: new deadline
 
 	image_unlock(_this);
 	return count;
 }
 
+// heat of a block at time "now": halved for every IMAGE_HEAT_HALFLIFE_MS
+static uint32_t image_blockstat_heat(image_blockstat_t *bs, uint64_t now) {
+	uint64_t halflifes;
+	if (now <= bs->heat_time_ms)
+		return bs->heat;
+	halflifes = (now - bs->heat_time_ms) / IMAGE_HEAT_HALFLIFE_MS;
+	return halflifes >= 32 ? 0 : bs->heat >> halflifes;
+}
+
+// count a PDP access to "count" bytes at the current position.
+// Called once per read/write command, after the seek
+void image_access_count(image_t *_this, int32_t count, int write) {
+	uint32_t blknr, startblknr, endblknr;
+	uint64_t now;
+	if (!_this->blockstat || count <= 0)
+		return;
+	now = now_ms();
+	image_lock(_this);
+	startblknr = _this->seekpos / _this->blocksize;
+	endblknr = (_this->seekpos + count - 1) / _this->blocksize;
+	if (endblknr >= _this->blockaccess_count)
+		endblknr = _this->blockaccess_count - 1;
+
+	// sequential access, or seek?
+	if (write)
+		_this->access_writes++;
+	else
+		_this->access_reads++;
+	if (startblknr == _this->access_next_blknr && _this->access_reads + _this->access_writes > 1) {
+		_this->access_sequential++;
+		_this->access_run_blocks += endblknr - startblknr + 1;
+	} else
+		_this->access_run_blocks = endblknr - startblknr + 1;
+	if (_this->access_run_blocks > _this->access_run_max)
+		_this->access_run_max = _this->access_run_blocks;
+	_this->access_next_blknr = endblknr + 1;
+
+	for (blknr = startblknr; blknr <= endblknr; blknr++) {
+		image_blockstat_t *bs = &_this->blockstat[blknr];
+		uint32_t heat;
+		if (write)
+			bs->writes++;
+		else
+			bs->reads++;
+		// decay to now, by whole half lifes only
+		heat = image_blockstat_heat(bs, now);
+		if (now > bs->heat_time_ms)
+			bs->heat_time_ms += (now - bs->heat_time_ms) / IMAGE_HEAT_HALFLIFE_MS
+					* IMAGE_HEAT_HALFLIFE_MS;
+		bs->heat = heat + IMAGE_HEAT_ONE < heat ? heat : heat + IMAGE_HEAT_ONE; // saturate
+		// for hot file layout
+		if (_this->blockaccess && _this->blockaccess[blknr] < UINT32_MAX)
+			_this->blockaccess[blknr]++;
+	}
+	image_unlock(_this);
+}
+
+// list all accessed blocks with read/write count, heat and file using it
+void image_heatmap_print(image_t *_this, FILE *stream) {
+	filesystem_t *fs = NULL;
+	int *owner;
+	uint32_t blknr, heat, commands;
+	uint64_t now = now_ms();
+
+	if (!_this->open || !_this->blockstat)
+		return;
+	image_lock(_this);
+	// parse a private filesystem on the current image, for file names
+	owner = malloc(_this->blockaccess_count * sizeof(int));
+	for (blknr = 0; blknr < _this->blockaccess_count; blknr++)
+		owner[blknr] = -1;
+	if (_this->dec_filesystem != fsNONE) {
+		fs = filesystem_create(_this->dec_filesystem, _this->dec_device, 1, _this->data,
+				_this->data_size, NULL);
+		if (filesystem_parse(fs) == ERROR_OK)
+			filesystem_block_owners(fs, owner, _this->blockaccess_count);
+	}
+	commands = _this->access_reads + _this->access_writes;
+	fprintf(stream, "Unit %d: %u read and %u write commands, %u%% sequential, "
+			"longest sequential run %u blocks\n", _this->unit, _this->access_reads,
+			_this->access_writes, commands ? 100 * _this->access_sequential / commands : 0,
+			_this->access_run_max);
+	fprintf(stream, " block    reads   writes     heat  file\n");
+	for (blknr = 0; blknr < _this->blockaccess_count; blknr++) {
+		image_blockstat_t *bs = &_this->blockstat[blknr];
+		if (!bs->reads && !bs->writes)
+			continue;
+		heat = image_blockstat_heat(bs, now);
+		fprintf(stream, "%6u %8u %8u %8.2f", blknr, bs->reads, bs->writes,
+				(double) heat / IMAGE_HEAT_ONE);
+		if (owner[blknr] >= 0) {
+			file_t *f = filesystem_file_get(fs, owner[blknr]);
+			fprintf(stream, "  %s", filesystem_filename_to_host(fs, f->filnam, f->ext, NULL));
+		}
+		fprintf(stream, "\n");
+	}
+	if (fs)
+		filesystem_destroy(fs);
+	free(owner);
+	image_unlock(_this);
+}
+
 // write image data to disk
 int image_save(image_t *_this) {
 	if (!_this->open)
@@ -437,19 +615,102 @@ int image_sync(image_t *_this) {
 			// merge files in the image and the shared directory
 			image_lock(_this);
 			hostdir_sync(_this->hostdir);
+			// layout may have changed by PDP or by rewritten blocks
+			if (_this->metadata_changed
+					|| !boolarray_is_empty(_this->hostdir->touched, _this->hostdir->touched->bitcount))
+				image_metadata_update(_this);
+			// under lock: a PDP write now must invalidate the parsed filesystem
+			boolarray_clear(_this->changedblocks);
 			image_unlock(_this);
 		} else {
 			// just save the image file
 			if (_this->changed)
 				result = image_save(_this);
+			boolarray_clear(_this->changedblocks);
 		}
 	}
-	boolarray_clear(_this->changedblocks);
 	return result;
 }
 
+// sync worker of a unit: syncs after the unit was idle for opt_synctimeout_sec.
+// Sleeps until the next sync is due, image_write() wakes it for a new deadline.
+// Units run independently, so a big shared dir does not delay others.
+static void *image_sync_worker(void *arg) {
+	image_t *_this = arg;
+	uint64_t now, next_sync_time, wakeup_time, t;
+	struct timespec ts;
+	int sync;
+
+	next_sync_time = now_ms() + opt_synctimeout_sec * 1000;
+	image_lock(_this);
+	while (!_this->sync_stop) {
+		now = now_ms();
+		sync = 0;
+		wakeup_time = 0; // wait for next write
+		if (opt_synctimeout_sec && _this->open && (_this->shared || _this->changed)) {
+			// shared dir may change anytime, an image file only by writes
+			t = _this->accesstime_ms + opt_synctimeout_sec * 1000;
+			wakeup_time = next_sync_time > t ? next_sync_time : t;
+			sync = wakeup_time < now;
+			if (_this->shared && _this->metadata_changed) {
+				// PDP has completed a directory write: export files, even if unit is busy
+				t = _this->metadata_changetime_ms + IMAGE_METADATA_SYNC_DELAY_MS;
+				if (t < now)
+					sync = 1;
+				else if (t < wakeup_time)
+					wakeup_time = t;
+			}
+		}
+		if (sync) {
+			image_unlock(_this);
+			if (opt_debug)
+				info("unit %d sync ", _this->unit);
+			image_sync(_this); // does locking
+			image_lock(_this);
+			next_sync_time = now_ms() + opt_synctimeout_sec * 1000;
+		} else if (wakeup_time) {
+			wakeup_time++; // due after the deadline
+			ts.tv_sec = wakeup_time / 1000;
+			ts.tv_nsec = (wakeup_time % 1000) * 1000000;
+			pthread_cond_timedwait(&_this->sync_wakeup, &_this->mutex, &ts);
+		} else
+			pthread_cond_wait(&_this->sync_wakeup, &_this->mutex);
+	}
+	image_unlock(_this);
+	return NULL;
+}
+
+// start the sync worker of an open unit
+void image_sync_start(image_t *_this) {
+	if (_this->sync_running)
+		return;
+	_this->sync_stop = 0;
+	if (pthread_create(&_this->sync_thread, NULL, image_sync_worker, _this))
+		error("unable to create sync thread for unit %d", _this->unit);
+	else
+		_this->sync_running = 1;
+}
+
+// terminate the sync worker, wait for a running sync to complete
+void image_sync_stop(image_t *_this) {
+	if (!_this->sync_running)
+		return;
+	image_lock(_this);
+	_this->sync_stop = 1;
+	pthread_cond_broadcast(&_this->sync_wakeup);
+	image_unlock(_this);
+	pthread_join(_this->sync_thread, NULL);
+	_this->sync_running = 0;
+}
+
 // no further read/write allowed.
 void image_destroy(image_t *_this) {
+	image_sync_stop(_this);
+	// shared dir: state for fast restart
+	if (_this->open && _this->shared && _this->hostdir) {
+		hostdir_manifest_save(_this->hostdir);
+		hostdir_hotfiles_save(_this->hostdir);
+	}
 	_this->open = 0;
 	if (_this->host_fpath)
 		free(_this->host_fpath);
@@ -458,12 +719,15 @@ void image_destroy(image_t *_this) {
 		free(_this->data);
 	_this->data = NULL;
 	_this->data_size = 0;
-	if (_this->shared) {
-		if (_this->hostdir)
-			hostdir_destroy(_this->hostdir);
-		if (_this->pdp_filesystem)
-			filesystem_destroy(_this->pdp_filesystem);
-	}
+	if (_this->shared && _this->hostdir)
+		hostdir_destroy(_this->hostdir);
+	if (_this->pdp_filesystem)
+		filesystem_destroy(_this->pdp_filesystem);
+	if (_this->blockaccess)
+		free(_this->blockaccess);
+	if (_this->blockstat)
+		free(_this->blockstat);
+	pthread_cond_destroy(&_this->sync_wakeup);
 	free(_this);
 }
 
@@ -33,6 +33,9 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026  JH  block access heatmap, sequential access statistics
+ *  18-Oct-2026  JH  block access counters
+ *  18-Oct-2026  JH  image file: filesystem parsed once, patch list
  *  07-May-2017  JH  passes GCC warning levels -Wall -Wextra
  *  20-Jan-2017  JH  created
  *
@@ -53,10 +56,30 @@
 // just for bitmap of changed blocks
 #define IMAGE_MAX_BLOCKS 1000000 // a 512 = > 512MB.
 
+// a shared image is synced this long after the PDP wrote its directory
+#define IMAGE_METADATA_SYNC_DELAY_MS	500
+
+// block heat is halved after this time without access
+#define IMAGE_HEAT_HALFLIFE_MS	60000
+#define IMAGE_HEAT_ONE	256 // heat of a single access, fixed point
+
+// PDP accesses to one block
+typedef struct {
+	uint32_t reads; // count of read commands
+	uint32_t writes;
+	uint32_t heat; // decayed access count * IMAGE_HEAT_ONE
+	uint64_t heat_time_ms; // heat is valid for this time
+} image_blockstat_t;
+
 // image file data structure, represents a tape
 typedef struct {
 	int unit;	// own unit number, user tag
 	pthread_mutex_t mutex;
+	// sync worker, see image_sync_start()
+	pthread_t sync_thread;
+	int8_t sync_running;
+	int8_t sync_stop; // 1: worker shall terminate
+	pthread_cond_t sync_wakeup; // signalled by image_write() and image_sync_stop()
 
 	// if loaded from disk image
 	char *host_fpath;		// file or directory name, valid while open
@@ -67,7 +90,11 @@ typedef struct {
 
 	struct stat host_fattr; // timestamps on open(), do track changes on disk
 	hostdir_t	*hostdir ; // if shared
-	filesystem_t *pdp_filesystem ;
+	filesystem_t *pdp_filesystem ; // image file: kept parsed for patch list
+	// image file: words changed by filesystem_patch(), sorted by offset.
+	// Restored in the saved data, not in the image
+	filesystem_patch_t patch[FILESYSTEM_MAX_PATCHES];
+	int patch_count;
 
 	// basic geometry
 	device_info_t *device_info ;
@@ -77,6 +104,21 @@ typedef struct {
 	int8_t changed; // was written since last save()
 	boolarray_t *changedblocks ;
 	uint64_t changetime_ms; // time of last write in milli secs
+	uint64_t accesstime_ms; // time of last read or write, for idle detection
+	boolarray_t *metadatablocks ; // shared: directory blocks of the filesystem
+	int8_t metadata_changed ; // PDP has written directory blocks since last sync/parse
+	uint64_t metadata_changetime_ms; // time of last directory write
+	// shared: PDP accesses per block since last sync, for hot file layout
+	uint32_t *blockaccess;
+	uint32_t blockaccess_count; // entries in blockaccess[] and blockstat[]
+	// access statistics, for heatmap
+	image_blockstat_t *blockstat;
+	uint32_t access_reads; // count of read commands
+	uint32_t access_writes;
+	uint32_t access_sequential; // commands starting at block after previous command
+	uint32_t access_next_blknr; // block after previous command
+	uint32_t access_run_blocks; // blocks in current sequential run
+	uint32_t access_run_max; // longest sequential run
 
 	// memory buffer for image
 	device_type_t dec_device ; // TU58
@@ -98,9 +140,13 @@ int image_blockseek(image_t *_this, int32_t size, int32_t block, int32_t offset)
 
 int image_read(image_t *_this, void *buf, int32_t count);
 int image_write(image_t *_this, void *buf, int32_t count);
+void image_access_count(image_t *_this, int32_t count, int write);
+void image_heatmap_print(image_t *_this, FILE *stream);
 int image_save(image_t *_this);
 
 int image_sync(image_t *_this);
+void image_sync_start(image_t *_this);
+void image_sync_stop(image_t *_this);
 
 void image_info(image_t *_this);
 
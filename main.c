@@ -35,6 +35,9 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026 JH              block heatmap: option "--heatmap", key "H"
+ *  18-Oct-2026 JH              new option "--hotlayout" for shared dirs
+ *  18-Oct-2026 JH              new option "--quiettime" for shared dirs
  *  17-May-2017 JH  V 1.3.0     new option "--usbdelay" for "--boot"
  *  07-May-2017 JH  V 1.2.1	    passes GCC warning levels -Wall -Wextra
  *  23-Mar-2017 JH  V 1.2.0     --boot option
@@ -98,6 +101,9 @@ int opt_background = 0; // set to run in background mode (no console I/O except
 int opt_synctimeout_sec = 0; // save changed image to disk after so many seconds of write-inactivity
 int opt_offlinetimeout_sec = 5; // disabled: TU58 waits with "offline" until so many seconds of RS232-inactivity
 int opt_usbdelay = 0; // extra delay of RS232 over USB adapters
+int opt_quiettime_ms = 1000; // shared dir: host file must be unchanged this long before import
+int opt_hotlayout = 0; // shared dir: frequently accessed files first on image
+char opt_heatmap_filename[4096] = ""; // write block access heatmap on exit, if set
 
 monitor_type_t opt_boot_monitor = monitor_none;
 int opt_boot_address = 07000; // end of first 4k page
@@ -328,6 +334,21 @@ static void parse_commandline(int argc, char **argv) {
 	getopt_def(&getopt_parser, "st", "synctimeout", "seconds", NULL, "3",
 			"An image changed by PDP is written to disk after this idle period.",
 			NULL, NULL, NULL, NULL);
+	getopt_def(&getopt_parser, "qt", "quiettime", "milliseconds", NULL, "1000",
+			"A file changed in a shared dir is put into the image only after it was\n"
+			"not written for this period, or its writer has closed it.\n"
+			"So files still being copied are not imported half written.",
+			NULL, NULL, NULL, NULL);
+	getopt_def(&getopt_parser, "hl", "hotlayout", NULL, NULL, NULL,
+			"Shared dirs: PDP accesses to each file are counted and saved in\n"
+			"\"<directory>.tu58hot\". When the image is built, frequently used files\n"
+			"are placed first within their file order group, to reduce seek time.",
+			NULL, NULL, NULL, NULL);
+	getopt_def(&getopt_parser, "hm", "heatmap", "filename", NULL, NULL,
+			"On exit, write PDP read/write counts and heat of every accessed block\n"
+			"with the file using it into <filename>. Also shown with key \"H\".",
+			"tu58.heat", "save block access statistics in \"tu58.heat\".",
+			NULL, NULL);
 	/*
 	 getopt_def(&getopt_parser, "ot", "offlinetimeout", "seconds", NULL, "3",
 	 "By hitting a number-key 0..7, the device goes offline for user control.\n"
@@ -406,6 +427,15 @@ static void parse_commandline(int argc, char **argv) {
 		} else if (getopt_isoption(&getopt_parser, "synctimeout")) {
 			if (getopt_arg_i(&getopt_parser, "seconds", &opt_synctimeout_sec) < 0)
 				commandline_option_error(NULL);
+		} else if (getopt_isoption(&getopt_parser, "quiettime")) {
+			if (getopt_arg_i(&getopt_parser, "milliseconds", &opt_quiettime_ms) < 0)
+				commandline_option_error(NULL);
+		} else if (getopt_isoption(&getopt_parser, "hotlayout")) {
+			opt_hotlayout = 1;
+		} else if (getopt_isoption(&getopt_parser, "heatmap")) {
+			if (getopt_arg_s(&getopt_parser, "filename", opt_heatmap_filename,
+					sizeof(opt_heatmap_filename)) < 0)
+				commandline_option_error(NULL);
 			/*
 			 } else if (getopt_isoption(&getopt_parser, "offlinetimeout")) {
 			 if (getopt_arg_i(&getopt_parser, "seconds", &opt_offlinetimeout_sec) < 0)
@@ -498,7 +528,7 @@ static void parse_commandline(int argc, char **argv) {
 			}
 
 			tu58image_create(unit, cur_image_size);
-			if (image_open(tu58image_get(unit), shared, readonly, allowcreate, pathbuff,
+			if (tu58image_open(unit, shared, readonly, allowcreate, pathbuff,
 					cur_filesystem_type) < 0)
 				commandline_option_error(NULL);
 			image_info(tu58image_get(unit));
@@ -578,7 +608,7 @@ static void parse_commandline(int argc, char **argv) {
 				fatal("hostdir_prepare failed");
 			if (hostdir_to_pdp_fs(hostdir))
 				fatal("hostdir_to_pdp_fs failed");
-			if (filesystem_render(pdp_fs))
+			if (filesystem_render(pdp_fs, NULL))
 				fatal("filesystem_render failed");
 			filesystem_print_dir(pdp_fs, ferr);
 			{
@@ -696,6 +726,17 @@ static void check_capabilities() {
 				"RT-11 v5.5 seems to be OK.");
 }
 
+// block access statistics of all open units
+static void heatmap_print(FILE *stream) {
+	image_t *img;
+	int unit;
+	for (unit = 0; unit < TU58_DEVICECOUNT; unit++) {
+		img = tu58image_get(unit);
+		if (img && img->open)
+			image_heatmap_print(img, stream);
+	}
+}
+
 static pthread_t th_run;	// emulator thread id
 static pthread_t th_monitor;	// monitor thread id
 
@@ -773,9 +814,9 @@ void run_emulator(void) {
 	// say hello
 	info("TU58 emulation start");
 #ifdef DEVICEDIALOG
-	info("0-7 device dialog, R restart, S toggle send init, V toggle verbose, D toggle debug, Q quit");
+	info("0-7 device dialog, R restart, S toggle send init, V toggle verbose, D toggle debug, H heatmap, Q quit");
 #else
-	info("R restart, S toggle send init, V toggle verbose, D toggle debug, Q quit");
+	info("R restart, S toggle send init, V toggle verbose, D toggle debug, H heatmap, Q quit");
 #endif
 
 	// run the emulator
@@ -821,6 +862,9 @@ void run_emulator(void) {
 				if (opt_debug)
 					fprintf(ferr, "\n");
 				info("send of <INIT> %sabled", tu58_doinit ? "en" : "dis");
+			} else if (c == 'H') {
+				// block access statistics
+				heatmap_print(ferr);
 			} else if (c == 'R') {
 				// kill and restart the emulator
 				if (pthread_cancel(th_run))
@@ -897,6 +941,15 @@ int main(int argc, char *argv[]) {
 		conrestore();
 		serial_devrestore(&tu58_serial);
 
+		if (strlen(opt_heatmap_filename)) {
+			FILE *f = fopen(opt_heatmap_filename, "w");
+			if (f) {
+				heatmap_print(f);
+				fclose(f);
+			} else
+				error("Can not write heatmap \"%s\"", opt_heatmap_filename);
+		}
+
 		// write back unsaved files and close
 		tu58images_closeall();
 	}
@@ -57,6 +57,9 @@ extern int opt_background ; // set to run in background mode (no console I/O exc
 extern int opt_synctimeout_sec ; // save changed image to disk after so many seconds of write-inactivity
 extern int opt_offlinetimeout_sec ; // TU58 waits with "offline" until so many seconds of RS232-inactivity
 extern int opt_usbdelay ; // extra delay of RS232 over USB adapters
+extern int opt_quiettime_ms ; // shared dir: host file must be unchanged this long before import
+extern int opt_hotlayout ; // shared dir: frequently accessed files first on image
+extern char opt_heatmap_filename[4096] ; // write block access heatmap on exit, if set
 
 #endif
 
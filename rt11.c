@@ -33,6 +33,17 @@
  *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
+ *  18-Oct-2026  JH  RAD-50 filename codec from utils
+ *  18-Oct-2026  JH  file index of blocks
+ *  18-Oct-2026  JH  list of patched words, for save without unpatch
+ *  18-Oct-2026  JH  files and streams allocated from arena
+ *  18-Oct-2026  JH  parsed file data are views into the image, not copied
+ *  18-Oct-2026  JH  changed files placed best fit into free areas
+ *  18-Oct-2026  JH  render writes only changed blocks
+ *  18-Oct-2026  JH  directory blocks reported for sync trigger
+ *  18-Oct-2026  JH  file data can be borrowed from caller
+ *  18-Oct-2026  JH  files found by hash index
+ *  18-Oct-2026  JH  update/delete single files in parsed image
  *  07-May-2017  JH  passes GCC warning levels -Wall -Wextra
  *  22-Jan-2017  JH  created
  *
@@ -130,11 +141,12 @@ static void stream_init(rt11_stream_t *stream) {
 	stream->byte_offset = 0;
 	stream->data = NULL;
 	stream->data_size = 0;
+	stream->borrowed = 0;
 	stream->name[0] = 0;
 }
 
-static rt11_stream_t *stream_create() {
-	rt11_stream_t *result = malloc(sizeof(rt11_stream_t));
+static rt11_stream_t *stream_create(rt11_filesystem_t *_this) {
+	rt11_stream_t *result = arena_alloc(_this->arena, sizeof(rt11_stream_t));
 	stream_init(result);
 	return result;
 }
@@ -150,23 +162,60 @@ static void stream_parse(rt11_filesystem_t *_this, rt11_stream_t *stream, rt11_b
 	stream->name[0] = 0; // must be set by caller
 }
 
-// write stream to image
-static void stream_render(rt11_filesystem_t *_this, rt11_stream_t *stream) {
-	uint8_t *dst = IMAGE_BLOCKNR2PTR(_this,stream->blocknr) + stream->byte_offset;
-	memcpy(dst, stream->data, stream->data_size);
+// let stream data point into the image, no copy.
+// Valid until the blocks are rewritten, see stream_own()
+static void stream_view(rt11_filesystem_t *_this, rt11_stream_t *stream, rt11_blocknr_t start,
+		uint32_t byte_offset, uint32_t data_size) {
+	stream->blocknr = start;
+	stream->byte_offset = byte_offset;
+	stream->data_size = data_size;
+	stream->data = IMAGE_BLOCKNR2PTR(_this, start) + byte_offset;
+	stream->borrowed = 1;
+	stream->name[0] = 0; // must be set by caller
+}
+
+// give stream its own copy of borrowed data, before its source is overwritten
+static void stream_own(rt11_stream_t *stream) {
+	uint8_t *data;
+	if (!stream || !stream->borrowed)
+		return;
+	data = malloc(stream->data_size);
+	memcpy(data, stream->data, stream->data_size);
+	stream->data = data;
+	stream->borrowed = 0;
+}
+
+// 1, if stream data is a view into the image, see stream_view()
+// (borrowed data may also be a mapped host file)
+static int stream_is_view(rt11_filesystem_t *_this, rt11_stream_t *stream) {
+	return stream && stream->borrowed && stream->data >= _this->image_data
+			&& stream->data < _this->image_data + _this->image_size;
+}
+
+// copy the part of the stream which lies in block "blocknr" into blk[]
+static void stream_block_compose(rt11_stream_t *stream, rt11_blocknr_t blocknr, uint8_t *blk) {
+	// byte positions relative to start of stream->blocknr
+	uint32_t blk_start = (blocknr - stream->blocknr) * RT11_BLOCKSIZE;
+	uint32_t start = stream->byte_offset, end = stream->byte_offset + stream->data_size;
+	if (blocknr < stream->blocknr)
+		return;
+	if (start < blk_start)
+		start = blk_start;
+	if (end > blk_start + RT11_BLOCKSIZE)
+		end = blk_start + RT11_BLOCKSIZE;
+	if (start < end)
+		memcpy(blk + start - blk_start, stream->data + start - stream->byte_offset, end - start);
 }
 
 // read block[start] ... block[start+blockcount-1] into data[]
+// stream itself is in the arena, only owned data is freed
 static void stream_destroy(rt11_stream_t *stream) {
-	if (stream) {
-		if (stream->data)
-			free(stream->data);
-		free(stream);
-	}
+	if (stream && stream->data && !stream->borrowed)
+		free(stream->data);
 }
 
-rt11_file_t *rt11_file_create() {
-	rt11_file_t *file = malloc(sizeof(rt11_file_t));
+static rt11_file_t *rt11_file_create(rt11_filesystem_t *_this) {
+	rt11_file_t *file = arena_alloc(_this->arena, sizeof(rt11_file_t));
 	file->data = NULL;
 	file->dir_ext = NULL;
 	file->prefix = NULL;
@@ -184,7 +233,6 @@ static void rt11_file_destroy(rt11_file_t * file) {
 		stream_destroy(file->data);
 		stream_destroy(file->dir_ext);
 		stream_destroy(file->prefix);
-		free(file);
 	}
 }
 
@@ -248,6 +296,66 @@ static void rt11_filesystem_mark_filestreams_as_changed(rt11_filesystem_t *_this
 	}
 }
 
+// forget the name index, after files in file[] were removed or reordered
+static void rt11_filesystem_file_hash_clear(rt11_filesystem_t *_this) {
+	memset(_this->file_hash, 0xff, sizeof(_this->file_hash)); // all -1
+	_this->file_hash_count = 0;
+}
+
+// enter files appended to file[] into the name index
+static void rt11_filesystem_file_hash_update(rt11_filesystem_t *_this) {
+	for (; _this->file_hash_count < _this->file_count; _this->file_hash_count++) {
+		rt11_file_t *f = _this->file[_this->file_hash_count];
+		uint32_t h = strhash(f->ext, strhash(f->filnam, STRHASH_INIT));
+		while (_this->file_hash[h % RT11_FILE_HASH_SIZE] >= 0)
+			h++; // linear probing
+		_this->file_hash[h % RT11_FILE_HASH_SIZE] = _this->file_hash_count;
+	}
+}
+
+// order of layout_prev[]: by RAD-50 name words
+static int rt11_layout_entry_cmp(const void *p1, const void *p2) {
+	const rt11_layout_entry_t *e1 = p1, *e2 = p2;
+	int i;
+	for (i = 0; i < 3; i++)
+		if (e1->name[i] != e2->name[i])
+			return e1->name[i] < e2->name[i] ? -1 : 1;
+	return 0;
+}
+
+// remember file positions in the image, for the next _render()
+static void rt11_filesystem_layout_save(rt11_filesystem_t *_this) {
+	int i;
+	_this->layout_prev = realloc(_this->layout_prev,
+			(_this->file_count + 1) * sizeof(rt11_layout_entry_t));
+	for (i = 0; i < _this->file_count; i++) {
+		rt11_file_t *f = _this->file[i];
+		rad50_encode_filename(f->filnam, f->ext, _this->layout_prev[i].name);
+		_this->layout_prev[i].block_nr = f->block_nr;
+		_this->layout_prev[i].block_count = f->block_count;
+	}
+	_this->layout_prev_count = _this->file_count;
+	qsort(_this->layout_prev, _this->layout_prev_count, sizeof(rt11_layout_entry_t),
+			rt11_layout_entry_cmp);
+}
+
+// 1, if the new layout put f to other blocks than the image holds it.
+// Views of a moved file must be copied before other files overwrite them.
+static int rt11_filesystem_file_moved(rt11_filesystem_t *_this, rt11_file_t *f) {
+	rt11_layout_entry_t key, *e;
+	rt11_stream_t *view[2] = { f->prefix, f->data };
+	int i;
+	for (i = 0; i < 2; i++)
+		if (stream_is_view(_this, view[i])
+				&& view[i]->data
+						!= IMAGE_BLOCKNR2PTR(_this, view[i]->blocknr) + view[i]->byte_offset)
+			return 1;
+	rad50_encode_filename(f->filnam, f->ext, key.name);
+	e = bsearch(&key, _this->layout_prev, _this->layout_prev_count,
+			sizeof(rt11_layout_entry_t), rt11_layout_entry_cmp);
+	return !e || e->block_nr != f->block_nr || e->block_count != f->block_count;
+}
+
 /*************************************************************************
  * constructor / destructor
  *************************************************************************/
@@ -283,10 +391,13 @@ rt11_filesystem_t *rt11_filesystem_create(device_type_t dec_device, uint8_t *ima
 	_this->monitor = malloc(sizeof(rt11_stream_t));
 	stream_init(_this->monitor);
 
-	// files vary: dynamic allocate
+	// files vary: allocated from arena, all released by init()
+	_this->arena = arena_create(64 * 1024);
 	_this->file_count = 0;
 	for (i = 0; i < RT11_MAX_FILES_PER_IMAGE; i++)
 		_this->file[i] = NULL;
+	_this->layout_prev = NULL;
+	_this->layout_prev_count = 0;
 	rt11_filesystem_init(_this);
 	return _this;
 }
@@ -299,6 +410,8 @@ void rt11_filesystem_destroy(rt11_filesystem_t *_this) {
 
 	free(_this->bootblock);
 	free(_this->monitor);
+	free(_this->layout_prev);
+	arena_destroy(_this->arena);
 	free(_this);
 }
 
@@ -342,7 +455,9 @@ void rt11_filesystem_init(rt11_filesystem_t *_this) {
 		rt11_file_destroy(_this->file[i]);
 		_this->file[i] = NULL;
 	}
+	arena_reset(_this->arena);
 	_this->file_count = 0;
+	rt11_filesystem_file_hash_clear(_this);
 
 	// defaults for home block, according to [VFFM91], page 1-3
 	_this->pack_cluster_size = 1;
@@ -461,15 +576,26 @@ static int rt11_filesystem_calc_block_use(rt11_filesystem_t *_this, int test_dat
 	return ERROR_OK;
 }
 
-// filnam, ext: strict 6/3 chars, padded with spaces
+// compare file name components, ignoring padding spaces.
+// parsed names are padded to 6/3 chars, names from host are not.
+static int rt11_filename_cmp(char *name1, char *name2) {
+	char buff[80];
+	strcpy(buff, strtrim(name1));
+	return strcasecmp(buff, strtrim(name2));
+}
+
+// filnam, ext: with or without padding spaces
 static rt11_file_t *rt11_filesystem_file_by_name(rt11_filesystem_t *_this, char *filnam,
 		char *ext) {
+	uint32_t h = strhash(ext, strhash(filnam, STRHASH_INIT));
 	rt11_file_t *f;
 	int i;
-	for (i = 0; i < _this->file_count; i++) {
+	rt11_filesystem_file_hash_update(_this);
+	while ((i = _this->file_hash[h % RT11_FILE_HASH_SIZE]) >= 0) {
 		f = _this->file[i];
-		if (!strcasecmp(filnam, f->filnam) && !strcasecmp(ext, f->ext))
+		if (!rt11_filename_cmp(filnam, f->filnam) && !rt11_filename_cmp(ext, f->ext))
 			return f;
+		h++;
 	}
 	return NULL;
 }
@@ -498,7 +624,7 @@ static int parse_homeblock(rt11_filesystem_t *_this) {
 				_this->first_dir_blocknr);
 	_this->first_dir_blocknr = rt11_image_get_word_at(_this, 1, 0724);
 	w = rt11_image_get_word_at(_this, 1, 0726);
-	strcpy(_this->system_version, rad50_decode(w));
+	rad50_decode(w, _this->system_version);
 	// 12 char volume id. V3A, or V05, ...
 	s = IMAGE_BLOCKNR2PTR(_this, 1) + 0730;
 	strncpy(_this->volume_id, (char *)s, 12);
@@ -533,6 +659,7 @@ static int parse_directory(rt11_filesystem_t *_this) {
 	uint32_t ds_nr = 0; // runs from 1
 	uint32_t ds_next_nr = 0;
 	uint32_t w;
+	uint16_t name_words[3]; // RAD-50 filnam.ext
 	uint16_t de_data_blocknr; // start blocknumber for file data
 
 	uint16_t *de; // directory entry in current directory segment
@@ -580,16 +707,13 @@ static int parse_directory(rt11_filesystem_t *_this) {
 				_this->free_blocks += w;
 			} else if (de_status & RT11_FILE_EPERM) { // only permanent files
 				// new file! read dir entry
-				rt11_file_t *f = rt11_file_create();
+				rt11_file_t *f = rt11_file_create(_this);
 				f->status = de_status;
-				// filnam: 6 chars
-				w = IMAGE_GET_WORD(de + 1);
-				strcat(f->filnam, rad50_decode(w));
-				w = IMAGE_GET_WORD(de + 2);
-				strcat(f->filnam, rad50_decode(w));
-				// extension: 3 chars
-				w = IMAGE_GET_WORD(de + 3);
-				strcpy(f->ext, rad50_decode(w));
+				// filnam: 6 chars, extension: 3 chars
+				name_words[0] = IMAGE_GET_WORD(de + 1);
+				name_words[1] = IMAGE_GET_WORD(de + 2);
+				name_words[2] = IMAGE_GET_WORD(de + 3);
+				rad50_decode_filename(name_words, f->filnam, f->ext);
 				// blocks in data stream
 				f->block_nr = de_data_blocknr; // startblock on disk
 				f->block_count = IMAGE_GET_WORD(de + 4);
@@ -619,7 +743,7 @@ static int parse_directory(rt11_filesystem_t *_this) {
 				// Extract extra bytes in directory entry as stream ...
 				if (_this->dir_entry_extra_bytes) {
 					assert(f->dir_ext == NULL);
-					f->dir_ext = stream_create();
+					f->dir_ext = stream_create(_this);
 					stream_parse(_this, f->dir_ext,
 					/*start block*/IMAGE_PTR2BLOCKNR(_this, de + 7),
 					/* byte_offset*/IMAGE_PTR2BLOCKOFFSET(_this, de + 7),
@@ -673,9 +797,9 @@ static void parse_file_data(rt11_filesystem_t *_this) {
 			prefix_block_count = *data_ptr; // first byte in block
 			// DEC: low byte of first word = blockcount
 			assert(f->prefix == NULL);
-			f->prefix = stream_create();
+			f->prefix = stream_create(_this);
 			// stream is everything behind first word
-			stream_parse(_this, f->prefix, f->block_nr, 2,
+			stream_view(_this, f->prefix, f->block_nr, 2,
 					prefix_block_count * RT11_BLOCKSIZE - 2);
 			strcpy(f->prefix->name, RT11_STREAMNAME_PREFIX);
 		} else
@@ -683,12 +807,22 @@ static void parse_file_data(rt11_filesystem_t *_this) {
 
 		// after prefix: remaining blocks are data
 		assert(f->data == NULL);
-		f->data = stream_create();
-		stream_parse(_this, f->data, f->block_nr + prefix_block_count, 0,
+		f->data = stream_create(_this);
+		// no copy: parse is called on every sync, data is needed only on export
+		stream_view(_this, f->data, f->block_nr + prefix_block_count, 0,
 				(f->block_count - prefix_block_count) * RT11_BLOCKSIZE);
 	}
 }
 
+// DD[X].SYS is patched in the image, so keep an unpatched copy
+static void parse_own_dd_sys(rt11_filesystem_t *_this, char *filnam, char *ext) {
+	rt11_file_t *f = rt11_filesystem_file_by_name(_this, filnam, ext);
+	if (f) {
+		stream_own(f->prefix);
+		stream_own(f->data);
+	}
+}
+
 // analyse the image, build filesystem data structure
 // parameters already set by _reset()
 // return: 0 = OK
@@ -712,6 +846,8 @@ int rt11_filesystem_parse(rt11_filesystem_t *_this) {
 	rt11_filesystem_unpatch(_this); 	// restore original DD[X].SYS
 
 	parse_file_data(_this);
+	parse_own_dd_sys(_this, "DD    ", "SYS");
+	parse_own_dd_sys(_this, "DDX   ", "SYS");
 
 	rt11_filesystem_patch(_this); 	// re-patch iamge
 
@@ -720,6 +856,7 @@ int rt11_filesystem_parse(rt11_filesystem_t *_this) {
 	// mark file->data , ->prefix as changed, for changed image blocks
 	rt11_filesystem_mark_filestreams_as_changed(_this);
 
+	rt11_filesystem_layout_save(_this);
 	return ERROR_OK;
 }
 
@@ -778,18 +915,53 @@ static int rt11_filesystem_layout(rt11_filesystem_t *_this) {
 	return ERROR_OK;
 }
 
-static void render_homeblock(rt11_filesystem_t *_this) {
-	uint8_t *homeblk = IMAGE_BLOCKNR2PTR(_this, 1);
-	uint16_t w;
+// mark blocks as rewritten. touched may be NULL
+static void touch_blocks(boolarray_t *touched, unsigned start, unsigned count) {
+	if (touched)
+		while (count--)
+			boolarray_bit_set(touched, start++);
+}
+
+// write blk[] into image block "blocknr".
+// compare: write only if content differs. Written blocks are "touched".
+static void render_block(rt11_filesystem_t *_this, rt11_blocknr_t blocknr, uint8_t *blk,
+		int compare, boolarray_t *touched) {
+	uint8_t *dst = IMAGE_BLOCKNR2PTR(_this, blocknr);
+	unsigned offset = blocknr * RT11_BLOCKSIZE, len = RT11_BLOCKSIZE;
+	if (offset >= _this->image_size)
+		return;
+	if (offset + len > _this->image_size)
+		len = _this->image_size - offset; // partial last block
+	if (compare && !memcmp(dst, blk, len))
+		return;
+	memcpy(dst, blk, len);
+	touch_blocks(touched, blocknr, 1);
+}
+
+// write bootblock or monitor to their fix blocks, rest of blocks cleared
+static void render_fixed_stream(rt11_filesystem_t *_this, rt11_stream_t *stream,
+		rt11_blocknr_t blocknr, unsigned block_count, boolarray_t *touched) {
+	uint8_t blk[RT11_BLOCKSIZE];
+	unsigned i;
+	for (i = 0; i < block_count; i++) {
+		memset(blk, 0, sizeof(blk));
+		if (stream && stream->data_size)
+			stream_block_compose(stream, blocknr + i, blk);
+		render_block(_this, blocknr + i, blk, 1, touched);
+	}
+}
+
+static void render_homeblock(rt11_filesystem_t *_this, boolarray_t *touched) {
+	uint8_t homeblk[RT11_BLOCKSIZE];
 	uint8_t *s;
 	int i, sum;
 
 	memset(homeblk, 0, RT11_BLOCKSIZE);
 	// write the bad block replacement table
 	// no idea about it, took from TU58 and RL02 image and from Don North
-	rt11_image_set_word_at(_this, 1, 0, 0000000);
-	rt11_image_set_word_at(_this, 1, 2, 0170000);
-	rt11_image_set_word_at(_this, 1, 4, 0007777);
+	IMAGE_PUT_WORD(homeblk + 0, 0000000);
+	IMAGE_PUT_WORD(homeblk + 2, 0170000);
+	IMAGE_PUT_WORD(homeblk + 4, 0007777);
 
 	// rest until 0203 was found to be 0x43 (RL02) or 0x00 ?
 
@@ -798,43 +970,44 @@ static void render_homeblock(rt11_filesystem_t *_this) {
 
 	// BUP information area 0252-0273 == 0xaa-0xbb found as 00's
 
-	rt11_image_set_word_at(_this, 1, 0722, _this->pack_cluster_size);
-	rt11_image_set_word_at(_this, 1, 0724, _this->first_dir_blocknr);
-
-	w = rad50_encode(_this->system_version);
-	rt11_image_set_word_at(_this, 1, 0726, w);
+	IMAGE_PUT_WORD(homeblk + 0722, _this->pack_cluster_size);
+	IMAGE_PUT_WORD(homeblk + 0724, _this->first_dir_blocknr);
+	IMAGE_PUT_WORD(homeblk + 0726, rad50_encode(_this->system_version));
 
 	// 12 char volume id. V3A, or V05, ...
-	s = IMAGE_BLOCKNR2PTR(_this, 1) + 0730;
+	s = homeblk + 0730;
 	// always 12 chars long, right padded with spaces
 	strcpy((char *)s, strrpad(_this->volume_id, 12, ' '));
 
 	// 12 char owner name
-	s = IMAGE_BLOCKNR2PTR(_this, 1) + 0744;
+	s = homeblk + 0744;
 	strcpy((char *)s, strrpad(_this->owner_name, 12, ' '));
 
 	// 12 char system id
-	s = IMAGE_BLOCKNR2PTR(_this, 1) + 0760;
+	s = homeblk + 0760;
 	strcpy((char *)s, strrpad(_this->system_id, 12, ' '));
 
 	// build checksum over all words
 	for (sum = i = 0; i < 0776; i += 2)
-		sum += rt11_image_get_word_at(_this, 1, i);
+		sum += IMAGE_GET_WORD(homeblk + i);
 	sum &= 0xffff;
 	_this->homeblock_chksum = sum;
-	rt11_image_set_word_at(_this, 1, 0776, sum);
+	IMAGE_PUT_WORD(homeblk + 0776, sum);
+
+	render_block(_this, 1, homeblk, 1, touched);
 }
 
 // write file f into segment ds_nr and entry de_nr
-// if f = NULL: write free chain entry
+// if f = NULL: write empty area of "empty_block_count" blocks
+// start_blocknr: start of file or empty area
 // must be called with ascending de_nr
 static int render_directory_entry(rt11_filesystem_t *_this, rt11_file_t *f, int ds_nr,
-		int de_nr) {
+		int de_nr, rt11_blocknr_t start_blocknr, rt11_blocknr_t empty_block_count) {
 	uint16_t *ds = DIR_SEGMENT(_this, ds_nr); // ptr to dir segment in image
 	uint16_t *de; // ptr to dir entry in image
 	int dir_entry_word_count = 7 + (_this->dir_entry_extra_bytes / 2);
 	uint16_t w;
-	char buff[80];
+	uint16_t name_words[3]; // RAD-50 filnam.ext
 	if (de_nr == 0) {
 		// 1st entry in segment: write 5 word header
 		IMAGE_PUT_WORD(ds + 0, _this->dir_total_seg_num);
@@ -844,24 +1017,22 @@ static int render_directory_entry(rt11_filesystem_t *_this, rt11_file_t *f, int
 			IMAGE_PUT_WORD(ds + 1, ds_nr + 1); // link to next segment
 		IMAGE_PUT_WORD(ds + 2, _this->dir_max_seg_nr);
 		IMAGE_PUT_WORD(ds + 3, _this->dir_entry_extra_bytes);
-		if (f)
-			IMAGE_PUT_WORD(ds + 4, f->block_nr); // start of first file on disk
-		else
-			// end marker at first entry
-			IMAGE_PUT_WORD(ds + 4, _this->file_space_blocknr);
+		IMAGE_PUT_WORD(ds + 4, start_blocknr); // start of first file or empty area on disk
 	}
 	// write dir_entry
 	de = ds + 5 + de_nr * dir_entry_word_count;
 	//fprintf(stderr, "ds_nr=%d, de_nr=%d, ds in img=0x%lx, de in img =0x%lx\n", ds_nr, de_nr,
 	//		(uint8_t*) ds - *_this->image_data_ptr, (uint8_t*) de - *_this->image_data_ptr);
+	// clear extra bytes, if not set by dir_ext stream
+	memset(de + 7, 0, _this->dir_entry_extra_bytes);
 	if (f == NULL) {
-		// write start of free chain: space after last file
+		// write empty area: free chain after last file, or gap between files
 		IMAGE_PUT_WORD(de + 0, RT11_FILE_EMPTY);
 		// after INIT free space has the name " EMPTY.FIL"
 		IMAGE_PUT_WORD(de + 1, rad50_encode(" EM"));
 		IMAGE_PUT_WORD(de + 2, rad50_encode("PTY"));
 		IMAGE_PUT_WORD(de + 3, rad50_encode("FIL"));
-		IMAGE_PUT_WORD(de + 4, _this->free_blocks); // block count
+		IMAGE_PUT_WORD(de + 4, empty_block_count); // block count
 		IMAGE_PUT_WORD(de + 5, 0); // job/channel
 		IMAGE_PUT_WORD(de + 6, 0); // INIT sets a creation date ... don't need to!
 	} else {
@@ -874,20 +1045,11 @@ static int render_directory_entry(rt11_filesystem_t *_this, rt11_file_t *f, int
 			w |= RT11_FILE_EPRE;
 		IMAGE_PUT_WORD(de + 0, w);
 
-		// filename chars 0..2
-		strncpy(buff, f->filnam, 3);
-		buff[3] = 0;
-		IMAGE_PUT_WORD(de + 1, rad50_encode(buff));
-
-		// filename chars 3..5
-		if (strlen(f->filnam) < 4)
-			buff[0] = 0;
-		else
-			strncpy(buff, f->filnam + 3, 3);
-		buff[3] = 0;
-		IMAGE_PUT_WORD(de + 2, rad50_encode(buff));
-		// ext
-		IMAGE_PUT_WORD(de + 3, rad50_encode(f->ext));
+		// filename chars 0..2, 3..5, ext
+		rad50_encode_filename(f->filnam, f->ext, name_words);
+		IMAGE_PUT_WORD(de + 1, name_words[0]);
+		IMAGE_PUT_WORD(de + 2, name_words[1]);
+		IMAGE_PUT_WORD(de + 3, name_words[2]);
 		// total file len
 		IMAGE_PUT_WORD(de + 4, f->block_count);
 		// clr job/channel
@@ -913,80 +1075,167 @@ static int render_directory_entry(rt11_filesystem_t *_this, rt11_file_t *f, int
 	return ERROR_OK;
 }
 
-// Pre: all files are arrange as gap-less stream, with only empty segment
-// after last file.
+// Pre: files in file[] are ordered by ascending block_nr, without overlap.
+// Space between files is written as empty area, space after last file
+// as start of free chain.
 static int render_directory(rt11_filesystem_t *_this) {
 	int i;
 	int dir_entries_per_segment = rt11_dir_entries_per_segment(_this); // cache
-	int ds_nr; // # of segment
-	int de_nr; // # of entry
+	int entry_count, entry_idx;
+	rt11_blocknr_t blocknr; // start of next entry
+	// count entries: files, gaps, mandatory free chain
+	entry_count = 1;
+	blocknr = _this->file_space_blocknr;
 	for (i = 0; i < _this->file_count; i++) {
 		rt11_file_t *f = _this->file[i];
-		// which segment?
-		ds_nr = (i / dir_entries_per_segment) + 1; // runs from 1
-		// which entry in the segment?
-		de_nr = i % dir_entries_per_segment; // runs from 0
-
-		render_directory_entry(_this, f, ds_nr, de_nr);
+		if (f->block_nr > blocknr)
+			entry_count++;
+		entry_count++;
+		blocknr = f->block_nr + f->block_count;
+	}
+	if (entry_count > _this->dir_total_seg_num * dir_entries_per_segment)
+		return error_set(ERROR_FILESYSTEM_OVERFLOW,
+				"render_directory(): %d entries do not fit into %d segments", entry_count,
+				_this->dir_total_seg_num);
+	_this->dir_max_seg_nr = (entry_count + dir_entries_per_segment - 1)
+			/ dir_entries_per_segment;
+
+	entry_idx = 0;
+	blocknr = _this->file_space_blocknr;
+	for (i = 0; i < _this->file_count; i++) {
+		rt11_file_t *f = _this->file[i];
+		// which segment runs from 1, entry in the segment from 0
+		if (f->block_nr > blocknr) {
+			// gap before file
+			render_directory_entry(_this, NULL, (entry_idx / dir_entries_per_segment) + 1,
+					entry_idx % dir_entries_per_segment, blocknr, f->block_nr - blocknr);
+			entry_idx++;
+		}
+		if (render_directory_entry(_this, f, (entry_idx / dir_entries_per_segment) + 1,
+				entry_idx % dir_entries_per_segment, f->block_nr, 0))
+			return error_code;
+		entry_idx++;
+		blocknr = f->block_nr + f->block_count;
 	}
 	// last entry: start of empty free chain
-	ds_nr = _this->file_count / dir_entries_per_segment + 1;
-	de_nr = _this->file_count % dir_entries_per_segment;
-	render_directory_entry(_this, NULL, ds_nr, de_nr);
+	render_directory_entry(_this, NULL, (entry_idx / dir_entries_per_segment) + 1,
+			entry_idx % dir_entries_per_segment, blocknr, _this->blockcount - blocknr);
 
 	return ERROR_OK;
 }
 
-// write file data into image
-static void render_file_data(rt11_filesystem_t *_this) {
+// rewrite all directory segments, unused space cleared.
+// Only blocks with different content are "touched".
+// On error the previous directory is restored.
+static int render_directory_diff(rt11_filesystem_t *_this, boolarray_t *touched) {
+	unsigned dir_size = 2 * _this->dir_total_seg_num * RT11_BLOCKSIZE;
+	uint8_t *dir = IMAGE_BLOCKNR2PTR(_this, _this->first_dir_blocknr);
+	uint8_t *saved;
+	unsigned i;
+
+	saved = malloc(dir_size);
+	memcpy(saved, dir, dir_size);
+	memset(dir, 0, dir_size);
+	if (render_directory(_this)) {
+		memcpy(dir, saved, dir_size);
+		free(saved);
+		return error_code;
+	}
+	for (i = 0; i < dir_size; i += RT11_BLOCKSIZE)
+		if (memcmp(saved + i, dir + i, RT11_BLOCKSIZE))
+			touch_blocks(touched, _this->first_dir_blocknr + i / RT11_BLOCKSIZE, 1);
+	free(saved);
+	return ERROR_OK;
+}
+
+// write prefix and data of a file block by block into the image.
+// Rest of last blocks cleared, DD[X].SYS patches in "patch" applied.
+// compare: write only blocks with different content
+static void render_file(rt11_filesystem_t *_this, rt11_file_t *f, rt11_patch_t *patch,
+		int patch_count, int compare, boolarray_t *touched) {
+	uint8_t blk[RT11_BLOCKSIZE];
+	uint16_t prefix_block_count = 0;
+	rt11_blocknr_t blknr;
 	int i;
-	for (i = 0; i < _this->file_count; i++) {
-		rt11_file_t *f = _this->file[i];
-		if (f->prefix) { 		// prefix block?
-			// low byte of 1st word on volume is blockcount,
-			uint16_t prefix_block_count = NEEDED_BLOCKS(RT11_BLOCKSIZE,
-					f->prefix->data_size + 2);
-			if (prefix_block_count > 255)
-				fatal("Render: Prefix of file \"%s.%s\" = %d blocks, maximum 255",
-						f->filnam, f->ext, prefix_block_count);
-
-			IMAGE_PUT_WORD(IMAGE_BLOCKNR2PTR(_this,f->prefix->blocknr), prefix_block_count);
+
+	if (f->prefix) { 		// prefix block?
+		// low byte of 1st word on volume is blockcount,
+		prefix_block_count = NEEDED_BLOCKS(RT11_BLOCKSIZE, f->prefix->data_size + 2);
+		if (prefix_block_count > 255)
+			fatal("Render: Prefix of file \"%s.%s\" = %d blocks, maximum 255", f->filnam,
+					f->ext, prefix_block_count);
+	}
+	for (blknr = f->block_nr; blknr < f->block_nr + f->block_count; blknr++) {
+		memset(blk, 0, sizeof(blk));
+		if (f->prefix) {
 			// start block and byte offset 2 already set by layout()
-			stream_render(_this, f->prefix);
+			if (blknr == f->prefix->blocknr)
+				IMAGE_PUT_WORD(blk, prefix_block_count);
+			stream_block_compose(f->prefix, blknr, blk);
 		}
 		if (f->data)
-			stream_render(_this, f->data);
+			stream_block_compose(f->data, blknr, blk);
+		for (i = 0; i < patch_count; i++)
+			if (patch[i].offset / RT11_BLOCKSIZE == blknr)
+				IMAGE_PUT_WORD(blk + patch[i].offset % RT11_BLOCKSIZE, patch[i].patched);
+		render_block(_this, blknr, blk, compare, touched);
 	}
 }
 
 // write filesystem into image
 // Assumes all file data and blocklists are valid
+// Only changed parts are rewritten: boot blocks, home block and directory
+// segments are compared against the image. Files still at their previous
+// position are compared, moved files are written. Rewritten blocks are
+// marked in "touched" (may be NULL). Free space is not cleared.
 // return: 0 = OK
-int rt11_filesystem_render(rt11_filesystem_t *_this) {
-
-	// format media, all 0's
-	memset(_this->image_data, 0, _this->image_size);
+int rt11_filesystem_render(rt11_filesystem_t *_this, boolarray_t *touched) {
+	rt11_patch_t patch[RT11_MAX_PATCHES];
+	int patch_count;
+	uint8_t *moved;
+	int i;
 
 	if (rt11_filesystem_layout(_this))
 		return error_code; // oversized
 
-	if (_this->bootblock->data_size)
-		stream_render(_this, _this->bootblock);
+	// other files are written over the old position of moved files.
+	// Other borrowed data (mapped host files) is not copied.
+	moved = malloc(_this->file_count + 1);
+	for (i = 0; i < _this->file_count; i++) {
+		rt11_file_t *f = _this->file[i];
+		moved[i] = rt11_filesystem_file_moved(_this, f);
+		if (moved[i] && stream_is_view(_this, f->prefix))
+			stream_own(f->prefix);
+		if (moved[i] && stream_is_view(_this, f->data))
+			stream_own(f->data);
+	}
+
 #ifdef DEFAULTBOOTLOADER
+	if (!_this->bootblock->data_size)
+		// volume not bootable
+		render_fixed_stream(_this, _this->nobootblock, 0, 1, touched);
 	else
-	// volume not bootable
-	stream_render(_this, _this->nobootblock);
 #endif
-	if (_this->monitor->data_size)
-		stream_render(_this, _this->monitor);
-	render_homeblock(_this);
-	if (render_directory(_this))
+	render_fixed_stream(_this, _this->bootblock, 0, 1, touched);
+	render_fixed_stream(_this, _this->monitor, 2, 4, touched);
+	render_homeblock(_this, touched);
+	if (render_directory_diff(_this, touched)) {
+		free(moved);
 		return error_code;
-	render_file_data(_this);
-
-	// modify DD[X].SYS
-	rt11_filesystem_patch(_this);
+	}
 
+	// modify DD[X].SYS while writing
+	patch_count = rt11_filesystem_patch_list(_this, patch);
+	for (i = 0; i < _this->file_count; i++) {
+		rt11_file_t *f = _this->file[i];
+		// unchanged file parsed from image: still in place
+		if (!moved[i] && (!f->prefix || stream_is_view(_this, f->prefix))
+				&& (!f->data || stream_is_view(_this, f->data)))
+			continue;
+		render_file(_this, f, patch, patch_count, !moved[i], touched);
+	}
+	free(moved);
+	rt11_filesystem_layout_save(_this);
 	return ERROR_OK;
 }
 
@@ -1023,6 +1272,29 @@ static int patch_dd_sys(rt11_filesystem_t *_this, char *filnam, char*ext,
 	return ERROR_OK;
 }
 
+// mark the directory segments in "mask".
+// A PDP write into these blocks changes the file list
+void rt11_filesystem_metadata_blocks(rt11_filesystem_t *_this, boolarray_t *mask) {
+	unsigned i;
+	// each segment is 2 blocks
+	for (i = 0; i < 2u * _this->dir_total_seg_num; i++)
+		boolarray_bit_set(mask, _this->first_dir_blocknr + i);
+}
+
+// set owner[blocknr] to the index of the file using that block.
+// owner[] is preset with -1 by caller
+void rt11_filesystem_block_owners(rt11_filesystem_t *_this, int *owner, unsigned block_count) {
+	unsigned blknr;
+	int file_idx;
+	for (file_idx = 0; file_idx < _this->file_count; file_idx++) {
+		rt11_file_t *f = _this->file[file_idx];
+		// files are contiguous, prefix blocks included
+		for (blknr = f->block_nr; blknr < (unsigned) f->block_nr + f->block_count
+				&& blknr < block_count; blknr++)
+			owner[blknr] = file_idx;
+	}
+}
+
 // write image blocksize into DD[X].SYS on image
 // called after image_load() / after filesystem_render()
 int rt11_filesystem_patch(rt11_filesystem_t *_this) {
@@ -1040,6 +1312,24 @@ int rt11_filesystem_unpatch(rt11_filesystem_t *_this) {
 	return ERROR_OK;
 }
 
+// list the words rt11_filesystem_patch() changes, to restore them
+// in a copy of the image. "patch" must hold RT11_MAX_PATCHES entries.
+int rt11_filesystem_patch_list(rt11_filesystem_t *_this, rt11_patch_t *patch) {
+	char *filnam[RT11_MAX_PATCHES] = { "DD    ", "DDX   " };
+	rt11_file_t *f;
+	int i, count = 0;
+	for (i = 0; i < RT11_MAX_PATCHES; i++) {
+		f = rt11_filesystem_file_by_name(_this, filnam[i], "SYS");
+		if (f && f->block_count >= 4) { // as patch_dd_sys()
+			patch[count].offset = f->block_nr * RT11_BLOCKSIZE + 0x2c;
+			patch[count].original = 512;
+			patch[count].patched = _this->blockcount;
+			count++;
+		}
+	}
+	return count;
+}
+
 /**************************************************************
  * FileAPI
  * add / get files in logical data structure
@@ -1048,12 +1338,13 @@ int rt11_filesystem_unpatch(rt11_filesystem_t *_this) {
 // fill the pseudo file with textual volume information
 static void rt11_filesystem_render_volumeinfo(rt11_filesystem_t *_this, rt11_file_t *f) {
 	// static stream instance as buffer for name=value text
-	static rt11_stream_t stream_buffer;
-	static char text_buffer[4096 + RT11_MAX_FILES_PER_IMAGE * 80]; // listing for all files
+	static THREAD_LOCAL rt11_stream_t stream_buffer;
+	static THREAD_LOCAL char text_buffer[4096 + RT11_MAX_FILES_PER_IMAGE * 80]; // listing for all files
 	char line[1024];
 	int i;
 	time_t t = time(NULL);
-	struct tm tm = *localtime(&t);
+	struct tm tm;
+	localtime_r(&t, &tm);
 
 	text_buffer[0] = 0;
 	sprintf(line, "# %s.%s - info about RT-11 volume on %s device.\n", f->filnam, f->ext,
@@ -1149,8 +1440,10 @@ static void rt11_filesystem_render_volumeinfo(rt11_filesystem_t *_this, rt11_fil
 //	it is interpreted to contain data for the "prefix" blocks
 //
 // result: -1  = volume overflow
+// borrow: 1 = data[] of regular files is not copied, must stay valid
+//	until filesystem_init() or _destroy()
 int rt11_filesystem_file_stream_add(rt11_filesystem_t *_this, char *hostfname, char *streamcode,
-		time_t hostfdate, mode_t hostmode, uint8_t *data, uint32_t data_size) {
+		time_t hostfdate, mode_t hostmode, uint8_t *data, uint32_t data_size, int borrow) {
 	// fprintf(stderr, "rt11_filesystem_file_stream_add(%s)\n", hostfname);
 	if (!strcasecmp(hostfname, RT11_VOLUMEINFO_FILNAM "." RT11_VOLUMEINFO_EXT)) {
 		// evaluate parameter file ?
@@ -1178,7 +1471,6 @@ int rt11_filesystem_file_stream_add(rt11_filesystem_t *_this, char *hostfname, c
 		//1. find file
 		rt11_file_t *f;
 		char filnam[40], ext[40];
-		int i;
 		rt11_stream_t **streamptr;
 		// regular file
 		if (_this->file_count + 1 >= RT11_MAX_FILES_PER_IMAGE)
@@ -1195,20 +1487,16 @@ int rt11_filesystem_file_stream_add(rt11_filesystem_t *_this, char *hostfname, c
 
 		// find file with this name. Duplicate check later
 		// duplicate file name? Likely! because of trunc to six letters
-		f = NULL;
-		for (i = 0; i < _this->file_count; i++) {
-			rt11_file_t *f1 = _this->file[i];
-			if (!strcasecmp(filnam, f1->filnam) && !strcasecmp(ext, f1->ext))
-				f = f1; // file exists, earlier another stream for f was written
-		}
+		// file exists, if earlier another stream for f was written
+		f = rt11_filesystem_file_by_name(_this, filnam, ext);
 		if (!f) {
 			// new file
-			f = rt11_file_create();
+			f = rt11_file_create(_this);
 			_this->file[_this->file_count++] = f;
 			strcpy(f->filnam, filnam);
 			strcpy(f->ext, ext);
 
-			f->date = *localtime(&hostfdate);
+			localtime_r(&hostfdate, &f->date);
 			// only range 1972..1999 allowed
 			if (f->date.tm_year < 72)
 				f->date.tm_year = 72;
@@ -1237,12 +1525,17 @@ int rt11_filesystem_file_stream_add(rt11_filesystem_t *_this, char *hostfname, c
 			return error_set(ERROR_FILESYSTEM_DUPLICATE, "Duplicate filename/stream %s.%s %s",
 					filnam, ext, streamcode);
 
-		*streamptr = stream_create();
+		*streamptr = stream_create(_this);
 		if (streamcode) // else remains ""
 			strcpy((*streamptr)->name, streamcode);
 		(*streamptr)->data_size = data_size;
-		(*streamptr)->data = malloc(data_size);
-		memcpy((*streamptr)->data, data, data_size);
+		if (borrow) {
+			(*streamptr)->data = data;
+			(*streamptr)->borrowed = 1;
+		} else {
+			(*streamptr)->data = malloc(data_size);
+			memcpy((*streamptr)->data, data, data_size);
+		}
 
 		// calc blocks count = prefix +data
 		f->block_count = 0;
@@ -1254,12 +1547,305 @@ int rt11_filesystem_file_stream_add(rt11_filesystem_t *_this, char *hostfname, c
 	return ERROR_OK;
 }
 
+/**************************************************************
+ * Incremental update
+ * replace or delete single file streams of a parsed filesystem
+ * directly in the image. Only the directory and the blocks of that file
+ * are rewritten, these blocks are marked in "touched" (may be NULL).
+ * ERROR_FILESYSTEM_OVERFLOW: change needs a new layout with _render()
+ **************************************************************/
+
+// rewrite directory segments. Only blocks with different content are "touched"
+static int rt11_filesystem_update_directory(rt11_filesystem_t *_this, boolarray_t *touched) {
+	unsigned i, used_file_blocks;
+
+	if (render_directory_diff(_this, touched))
+		return error_code;
+
+	// update statistics
+	used_file_blocks = 0;
+	for (i = 0; i < (unsigned) _this->file_count; i++)
+		used_file_blocks += _this->file[i]->block_count;
+	_this->used_file_blocks = used_file_blocks;
+	_this->free_blocks = _this->blockcount - _this->file_space_blocknr - used_file_blocks;
+	rt11_filesystem_layout_save(_this);
+	return ERROR_OK;
+}
+
+// write prefix and data of a file into its blocks, rest of blocks cleared.
+// Only blocks with different content are "touched"
+static void rt11_filesystem_update_file_data(rt11_filesystem_t *_this, rt11_file_t *f,
+		boolarray_t *touched) {
+	rt11_patch_t patch[RT11_MAX_PATCHES];
+	unsigned blknr = f->block_nr;
+	// views may point into the blocks rewritten now
+	stream_own(f->prefix);
+	stream_own(f->data);
+	if (f->prefix) {
+		f->prefix->blocknr = blknr;
+		f->prefix->byte_offset = 2;
+		blknr += NEEDED_BLOCKS(RT11_BLOCKSIZE, f->prefix->data_size + 2);
+	}
+	if (f->data) {
+		f->data->blocknr = blknr;
+		f->data->byte_offset = 0;
+	}
+	// DD.SYS may be new or moved
+	render_file(_this, f, patch, rt11_filesystem_patch_list(_this, patch), 1, touched);
+}
+
+// list free areas between files and behind the last file, ascending.
+// file "ignore" is treated as deleted. Result count in *count, free() by caller
+static rt11_extent_t *rt11_filesystem_free_extents(rt11_filesystem_t *_this,
+		rt11_file_t *ignore, int *count) {
+	rt11_extent_t *result = malloc((_this->file_count + 1) * sizeof(rt11_extent_t));
+	unsigned blocknr = _this->file_space_blocknr;
+	int i;
+
+	*count = 0;
+	for (i = 0; i <= _this->file_count; i++) {
+		unsigned end = _this->blockcount; // behind last file
+		if (i < _this->file_count) {
+			if (_this->file[i] == ignore)
+				continue;
+			end = _this->file[i]->block_nr;
+		}
+		if (end > blocknr) {
+			result[*count].blocknr = blocknr;
+			result[*count].block_count = end - blocknr;
+			(*count)++;
+		}
+		if (i < _this->file_count)
+			blocknr = _this->file[i]->block_nr + _this->file[i]->block_count;
+	}
+	return result;
+}
+
+// set new size of file f and find its start block.
+// f stays in place, if the free space around it is large enough,
+// else it is moved into the smallest free area it fits (best fit).
+// Other files are never moved.
+// if f is not yet in file[], it is inserted.
+static int rt11_filesystem_file_place(rt11_filesystem_t *_this, rt11_file_t *f,
+		unsigned block_count) {
+	rt11_extent_t *extent;
+	int extent_count;
+	int i, idx, best;
+
+	for (idx = -1, i = 0; idx < 0 && i < _this->file_count; i++)
+		if (_this->file[i] == f)
+			idx = i;
+	extent = rt11_filesystem_free_extents(_this, f, &extent_count);
+	best = -1;
+	for (i = 0; i < extent_count; i++) {
+		rt11_extent_t *e = &extent[i];
+		if (idx >= 0 && f->block_nr >= e->blocknr
+				&& f->block_nr + block_count <= e->blocknr + e->block_count) {
+			// in place
+			free(extent);
+			f->block_count = block_count;
+			return ERROR_OK;
+		}
+		if (e->block_count >= block_count
+				&& (best < 0 || e->block_count < extent[best].block_count))
+			best = i;
+	}
+	if (best < 0) {
+		free(extent);
+		return error_set(ERROR_FILESYSTEM_OVERFLOW, NULL); // silent
+	}
+	if (idx >= 0) {
+		// remove from old position
+		memmove(&_this->file[idx], &_this->file[idx + 1],
+				(_this->file_count - idx - 1) * sizeof(rt11_file_t *));
+		_this->file_count--;
+	}
+	f->block_nr = extent[best].blocknr;
+	f->block_count = block_count;
+	free(extent);
+	// insert, file[] stays sorted by block_nr
+	for (idx = 0; idx < _this->file_count && _this->file[idx]->block_nr < f->block_nr; idx++)
+		;
+	memmove(&_this->file[idx + 1], &_this->file[idx],
+			(_this->file_count - idx) * sizeof(rt11_file_t *));
+	_this->file[idx] = f;
+	_this->file_count++;
+	rt11_filesystem_file_hash_clear(_this);
+	return ERROR_OK;
+}
+
+// total blocks for prefix and data
+static unsigned rt11_file_block_count(rt11_file_t *f) {
+	unsigned result = 0;
+	if (f->prefix)
+		result += NEEDED_BLOCKS(RT11_BLOCKSIZE, f->prefix->data_size + 2); // 2 bytes length word
+	if (f->data)
+		result += NEEDED_BLOCKS(RT11_BLOCKSIZE, f->data->data_size);
+	return result;
+}
+
+// write bootblock or monitor at their fix position
+static void rt11_filesystem_update_bootfile(rt11_filesystem_t *_this, rt11_stream_t *stream,
+		rt11_blocknr_t blocknr, unsigned block_count, boolarray_t *touched) {
+	stream->blocknr = blocknr;
+	stream->byte_offset = 0;
+	render_fixed_stream(_this, stream, blocknr, block_count, touched);
+}
+
+// add or replace a stream of a file in a parsed filesystem. See _file_stream_add()
+int rt11_filesystem_file_stream_update(rt11_filesystem_t *_this, char *hostfname,
+		char *streamcode, time_t hostfdate, mode_t hostmode, uint8_t *data, uint32_t data_size,
+		boolarray_t *touched) {
+	rt11_file_t *f;
+	char filnam[40], ext[40];
+	rt11_stream_t **streamptr;
+	int created;
+
+	if (!strcasecmp(hostfname, RT11_VOLUMEINFO_FILNAM "." RT11_VOLUMEINFO_EXT))
+		return ERROR_OK; // generated, never written to image
+	if (!strcasecmp(hostfname, RT11_BOOTBLOCK_FILNAM "." RT11_BOOTBLOCK_EXT)) {
+		if (!streamcode) {
+			if (rt11_filesystem_file_stream_add(_this, hostfname, streamcode, hostfdate, hostmode,
+					data, data_size, 0))
+				return error_code;
+			rt11_filesystem_update_bootfile(_this, _this->bootblock, 0, 1, touched);
+		}
+		return ERROR_OK;
+	}
+	if (!strcasecmp(hostfname, RT11_MONITOR_FILNAM "." RT11_MONITOR_EXT)) {
+		if (!streamcode) {
+			if (rt11_filesystem_file_stream_add(_this, hostfname, streamcode, hostfdate, hostmode,
+					data, data_size, 0))
+				return error_code;
+			rt11_filesystem_update_bootfile(_this, _this->monitor, 2, 4, touched);
+		}
+		return ERROR_OK;
+	}
+
+	// regular file
+	rt11_filename_from_host(hostfname, filnam, ext);
+	f = rt11_filesystem_file_by_name(_this, filnam, ext);
+	created = (f == NULL);
+	if (created) {
+		if (_this->file_count + 1 >= RT11_MAX_FILES_PER_IMAGE)
+			return error_set(ERROR_FILESYSTEM_OVERFLOW, "Too many files, only %d allowed",
+			RT11_MAX_FILES_PER_IMAGE);
+		f = rt11_file_create(_this);
+		strcpy(f->filnam, filnam);
+		strcpy(f->ext, ext);
+		f->data = stream_create(_this); // data stream always there, may be empty
+	}
+	if (!streamcode || strlen(streamcode) == 0) {
+		streamptr = &f->data;
+		f->readonly = !(hostmode & S_IWUSR);
+		localtime_r(&hostfdate, &f->date);
+		// only range 1972..1999 allowed
+		if (f->date.tm_year < 72)
+			f->date.tm_year = 72;
+		else if (f->date.tm_year > 99)
+			f->date.tm_year = 99;
+	} else if (!strcasecmp(streamcode, RT11_STREAMNAME_DIREXT)) {
+		streamptr = &f->dir_ext;
+		// directory entries can not grow without new layout
+		if (data_size > _this->dir_entry_extra_bytes)
+			streamptr = NULL;
+	} else if (!strcasecmp(streamcode, RT11_STREAMNAME_PREFIX)) {
+		streamptr = &f->prefix;
+	} else
+		streamptr = NULL;
+	if (!streamptr) {
+		if (created)
+			rt11_file_destroy(f);
+		return error_set(ERROR_FILESYSTEM_OVERFLOW, NULL);
+	}
+
+	if (*streamptr) {
+		// reuse the arena object
+		stream_destroy(*streamptr);
+		stream_init(*streamptr);
+	} else
+		*streamptr = stream_create(_this);
+	if (streamcode) // else remains ""
+		strcpy((*streamptr)->name, streamcode);
+	(*streamptr)->data_size = data_size;
+	(*streamptr)->data = malloc(data_size);
+	memcpy((*streamptr)->data, data, data_size);
+
+	if (rt11_filesystem_file_place(_this, f, rt11_file_block_count(f))) {
+		if (created)
+			rt11_file_destroy(f);
+		return error_code;
+	}
+	if (streamptr != &f->dir_ext)
+		rt11_filesystem_update_file_data(_this, f, touched);
+	return rt11_filesystem_update_directory(_this, touched);
+}
+
+// remove a stream of a file in a parsed filesystem.
+// file is deleted with its data stream, if it has no other streams.
+int rt11_filesystem_file_stream_delete(rt11_filesystem_t *_this, char *hostfname,
+		char *streamcode, boolarray_t *touched) {
+	rt11_file_t *f;
+	char filnam[40], ext[40];
+	int i;
+
+	if (!strcasecmp(hostfname, RT11_VOLUMEINFO_FILNAM "." RT11_VOLUMEINFO_EXT))
+		return ERROR_OK;
+	if (!strcasecmp(hostfname, RT11_BOOTBLOCK_FILNAM "." RT11_BOOTBLOCK_EXT)) {
+		if (!streamcode) {
+			_this->bootblock->data_size = 0;
+			rt11_filesystem_update_bootfile(_this, _this->bootblock, 0, 1, touched);
+		}
+		return ERROR_OK;
+	}
+	if (!strcasecmp(hostfname, RT11_MONITOR_FILNAM "." RT11_MONITOR_EXT)) {
+		if (!streamcode) {
+			_this->monitor->data_size = 0;
+			rt11_filesystem_update_bootfile(_this, _this->monitor, 2, 4, touched);
+		}
+		return ERROR_OK;
+	}
+
+	rt11_filename_from_host(hostfname, filnam, ext);
+	f = rt11_filesystem_file_by_name(_this, filnam, ext);
+	if (!f)
+		return ERROR_OK; // already gone
+	if (!streamcode || strlen(streamcode) == 0) {
+		if (!f->prefix && !f->dir_ext) {
+			// last stream: remove file, leaves a gap
+			for (i = 0; _this->file[i] != f; i++)
+				;
+			memmove(&_this->file[i], &_this->file[i + 1],
+					(_this->file_count - i - 1) * sizeof(rt11_file_t *));
+			_this->file_count--;
+			_this->file[_this->file_count] = NULL;
+			rt11_filesystem_file_hash_clear(_this);
+			rt11_file_destroy(f);
+			return rt11_filesystem_update_directory(_this, touched);
+		}
+		stream_destroy(f->data);
+		stream_init(f->data);
+	} else if (!strcasecmp(streamcode, RT11_STREAMNAME_DIREXT)) {
+		stream_destroy(f->dir_ext);
+		f->dir_ext = NULL;
+		return rt11_filesystem_update_directory(_this, touched);
+	} else if (!strcasecmp(streamcode, RT11_STREAMNAME_PREFIX)) {
+		stream_destroy(f->prefix);
+		f->prefix = NULL;
+	} else
+		return error_set(ERROR_FILESYSTEM_OVERFLOW, NULL);
+	// file shrinks in place
+	rt11_filesystem_file_place(_this, f, rt11_file_block_count(f));
+	rt11_filesystem_update_file_data(_this, f, touched);
+	return rt11_filesystem_update_directory(_this, touched);
+}
+
 // access files,and special bootblock/monitor/volumeinfo in an uniform way
 // -3 = volume info, -2 = monitor, -1 = boot block
 // bootblock is NULL, if empty
 rt11_file_t *rt11_filesystem_file_get(rt11_filesystem_t *_this, int fileidx) {
 	rt11_file_t *result = NULL;
-	static rt11_file_t buff[3]; // buffer for bootblock, monitor, volinfo
+	static THREAD_LOCAL rt11_file_t buff[3]; // buffer for bootblock, monitor, volinfo
 	if (fileidx == -3) {
 		result = &buff[0];
 		strcpy(result->filnam, RT11_VOLUMEINFO_FILNAM);
@@ -1295,7 +1881,7 @@ rt11_file_t *rt11_filesystem_file_get(rt11_filesystem_t *_this, int fileidx) {
 static char *rt11_date_text(struct tm t) {
 	char *mon[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov",
 			"Dec" };
-	static char buff[80];
+	static THREAD_LOCAL char buff[80];
 	sprintf(buff, "%02d-%3s-%02d", t.tm_mday, mon[t.tm_mon], t.tm_year);
 	return buff;
 }
@@ -1308,7 +1894,7 @@ static char *rt11_date_text(struct tm t) {
 //  320 Free blocks
 
 static char *rt11_dir_entry_text(rt11_filesystem_t *_this, int fileidx) {
-	static char buff[80];
+	static THREAD_LOCAL char buff[80];
 	rt11_file_t *f = _this->file[fileidx];
 	sprintf(buff, "%6s.%-3s%6d%c %s", f->filnam, f->ext, f->block_count,
 			f->readonly ? 'P' : ' ', rt11_date_text(f->date));
@@ -1347,7 +1933,7 @@ void rt11_filesystem_print_diag(rt11_filesystem_t *_this, FILE *stream) {
 
 // make filname.ext[.streamname]
 char *rt11_filename_to_host(char *filnam, char *ext, char *streamname) {
-	static char result[80];
+	static THREAD_LOCAL char result[80];
 	char _filnam[80], _ext[80];
 	// remove surrounding spaces.
 	// all XXDP filename chars are valid host chars (" ", "$", "%")
@@ -1373,7 +1959,7 @@ char *rt11_filename_to_host(char *filnam, char *ext, char *streamname) {
 // "filname" and "ext" contain components WITH spaces, if != NULL
 // "bla.foo.c" => "BLA.FO", "C  ", result = "BLA.FO.C"
 char *rt11_filename_from_host(char *hostfname, char *filnam, char *ext) {
-	static char result[80];
+	static THREAD_LOCAL char result[80];
 	char pathbuff[4096];
 	char _filnam[7], _ext[4];
 	char *s, *t;
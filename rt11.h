@@ -33,6 +33,12 @@
  *  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
+ *  18-Oct-2026  JH  file index of blocks
+ *  18-Oct-2026  JH  list of patched words
+ *  18-Oct-2026  JH  files and streams allocated from arena
+ *  18-Oct-2026  JH  parsed file data are views into the image
+ *  18-Oct-2026  JH  free extents for file placement
+ *  18-Oct-2026  JH  render reports changed blocks
  *  07-May-2017  JH  passes GCC warning levels -Wall -Wextra
  *  12-Jan-2017  JH  created
  */
@@ -41,6 +47,7 @@
 
 #include <sys/types.h>
 #include "rt11_radi.h"
+#include "arena.h"
 
 #define RT11_BLOCKSIZE   512
 #define RT11_MAX_BLOCKCOUNT 0x10000 // block addr only 16 bit
@@ -56,6 +63,8 @@
 
 // own limits
 #define	RT11_MAX_FILES_PER_IMAGE 1000
+#define RT11_MAX_PATCHES	2 // DD.SYS and DDX.SYS
+#define RT11_FILE_HASH_SIZE	2048 // power of 2, well above RT11_MAX_FILES_PER_IMAGE
 
 // pseudo file for volume parameters
 #define RT11_VOLUMEINFO_FILNAM	"$VOLUM" // valid RT11 file name
@@ -78,6 +87,26 @@
 
 typedef uint16_t rt11_blocknr_t;
 
+// a word changed by rt11_filesystem_patch() in the image, never in disk files
+typedef struct {
+	uint32_t offset; // byte position in image
+	uint16_t original; // value to save
+	uint16_t patched; // value in image
+} rt11_patch_t;
+
+// position of a file in the image, as last parsed or rendered
+typedef struct {
+	uint16_t name[3]; // RAD-50 filnam.ext
+	rt11_blocknr_t block_nr; // start of prefix and data
+	rt11_blocknr_t block_count;
+} rt11_layout_entry_t;
+
+// a contiguous area on the volume, used for free space
+typedef struct {
+	rt11_blocknr_t blocknr; // start block
+	unsigned block_count;
+} rt11_extent_t;
+
 // a stream of data
 // - for the bootloader on a rt11 image
 // - file data, -prefixes and extra dir entries
@@ -87,6 +116,7 @@ typedef struct {
 //	rt11_blocknr_t blockcount; // count of blocks
 	uint8_t *data;  // space for blockcount * BLOCKSIZE data
 	uint32_t data_size; // byte count in data[]
+	uint8_t borrowed; // 1: data[] not owned, not freed: mapped host file, or view into image
 	char name[80]; // name of stream, used as additional extension for hostfiles
 	uint8_t changed; // calc'd from image_changed_blocks
 } rt11_stream_t;
@@ -155,8 +185,12 @@ typedef struct {
 
 	int struct_changed ; // directories or homeblock changed
 
+	arena_t *arena; // rt11_file_t and rt11_stream_t of file[], reset by init()
 	int file_count; // signed, because there are negative file_idx
 	rt11_file_t *file[RT11_MAX_FILES_PER_IMAGE];
+	// index into file[] by filnam.ext, open addressing. -1 = empty
+	int file_hash[RT11_FILE_HASH_SIZE];
+	int file_hash_count; // file[0..file_hash_count-1] are indexed
 
 	// cache directory statistics
 	rt11_blocknr_t	used_file_blocks ;
@@ -164,6 +198,11 @@ typedef struct {
 
 	rt11_blocknr_t	file_space_blocknr ; // start of file space area
 	rt11_blocknr_t	render_free_space_blocknr ; // start of free space for renderer
+
+	// file positions in the image content, sorted by name. Not cleared by init():
+	// render() compares files still at their position, new or moved files are written
+	rt11_layout_entry_t *layout_prev;
+	int layout_prev_count;
 } rt11_filesystem_t;
 
 #if !defined(_RT11_C_) && !defined(_RT11_RADI_C_)
@@ -181,14 +220,28 @@ void rt11_filesystem_init(rt11_filesystem_t *_this);
 int rt11_filesystem_parse(rt11_filesystem_t *_this);
 
 int rt11_filesystem_file_stream_add(rt11_filesystem_t *_this, char *hostfname, char *streamcode,
-		time_t hostfdate, mode_t hostmode, uint8_t *data, uint32_t data_size);
+		time_t hostfdate, mode_t hostmode, uint8_t *data, uint32_t data_size, int borrow);
+
+int rt11_filesystem_render(rt11_filesystem_t *_this, boolarray_t *touched);
+
+// modify a parsed filesystem
+int rt11_filesystem_file_stream_update(rt11_filesystem_t *_this, char *hostfname,
+		char *streamcode, time_t hostfdate, mode_t hostmode, uint8_t *data, uint32_t data_size,
+		boolarray_t *touched);
+int rt11_filesystem_file_stream_delete(rt11_filesystem_t *_this, char *hostfname,
+		char *streamcode, boolarray_t *touched);
 
-int rt11_filesystem_render(rt11_filesystem_t *_this);
+// mark directory blocks of a parsed filesystem
+void rt11_filesystem_metadata_blocks(rt11_filesystem_t *_this, boolarray_t *mask);
+// file index for each block, -1 if not in a file
+void rt11_filesystem_block_owners(rt11_filesystem_t *_this, int *owner, unsigned block_count);
 
 // write image blocksize into DD[X].SYS
 int rt11_filesystem_patch(rt11_filesystem_t *_this) ;
 // restore original DD[X].SYS
 int rt11_filesystem_unpatch(rt11_filesystem_t *_this) ;
+// words changed by rt11_filesystem_patch(), result is count
+int rt11_filesystem_patch_list(rt11_filesystem_t *_this, rt11_patch_t *patch) ;
 
 
 rt11_file_t *rt11_filesystem_file_get(rt11_filesystem_t *_this, int fileidx);
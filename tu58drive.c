@@ -37,6 +37,11 @@
  *  Neurobiology. We copyright (C) it and permit its use provided it is not
  *  sold to others. Originally written by Dan Ts'o circa 1984 or so.
  *
+ *  18-Oct-2026 JH  reads and writes counted separately, heatmap
+ *  18-Oct-2026 JH  block accesses counted per command
+ *  18-Oct-2026 JH  early sync only for shared units
+ *  18-Oct-2026 JH  early sync after PDP directory write
+ *  18-Oct-2026 JH  sync worker thread per unit
  *  07-May-2017 JH, Don North  compiles under MACOS, passes GCC warning levels -Wall -Wextra
  *  12-Jan-2017 JH  taken from tu58em
  */
@@ -130,6 +135,16 @@ image_t *tu58image_create(int32_t unit, int forced_data_size) {
 	return tu58_image[unit];
 }
 
+// open the image of a unit, and start its sync worker
+int tu58image_open(int32_t unit, int shared, int readonly, int allowcreate, char *fname,
+		filesystem_type_t dec_filesystem) {
+	image_t *img = tu58image_get(unit);
+	int result = image_open(img, shared, readonly, allowcreate, fname, dec_filesystem);
+	if (result == ERROR_OK)
+		image_sync_start(img);
+	return result;
+}
+
 // select image over unit number
 image_t *tu58image_get(int32_t unit) {
 	if (!IMAGE_UNIT_VALID(unit)) {
@@ -146,6 +161,7 @@ void tu58images_closeall(void) {
 	for (unit = 0; unit < TU58_DEVICECOUNT; unit++) {
 		img = tu58_image[unit];
 		if (img) {
+			image_sync_stop(img); // no sync running now
 			if (img->open)
 				image_sync(img);
 			image_destroy(img);
@@ -153,25 +169,6 @@ void tu58images_closeall(void) {
 	}
 }
 
-// save changed images after idle delay
-void tu58images_sync_all() {
-	image_t *img;
-	int32_t unit;
-
-	if (!opt_synctimeout_sec)
-		return; // not wanted
-
-	for (unit = 0; unit < TU58_DEVICECOUNT; unit++) {
-		img = tu58_image[unit];
-
-		if (img && img->open) {
-			if (opt_debug)
-				info("unit %d sync ", unit);
-			image_sync(img); // does locking
-		}
-	}
-}
-
 //
 
 // reinitialize TU58 state
@@ -456,6 +453,8 @@ static void turead(tu_cmdpkt *pk) {
 		return;
 	}
 
+	image_access_count(img, pk->count, 0);
+
 	// fake a seek time
 	delay_ms(tudelay[opt_timing].seek);
 
@@ -523,6 +522,8 @@ static void tuwrite(tu_cmdpkt *pk) {
 		return;
 	}
 
+	image_access_count(img, pk->count, 1);
+
 	// fake a seek time
 	delay_ms(tudelay[opt_timing].seek);
 
@@ -963,11 +964,8 @@ void* tu58_server(void* none) {
 //
 void* tu58_monitor(void* none) {
 	int32_t sts;
-	uint64_t now;
-	uint64_t next_sync_time;
 	UNUSED(none) ;
 
-	next_sync_time = now_ms() + opt_synctimeout_sec * 1000;
 	for (;;) {
 
 		// check for any error
@@ -995,16 +993,6 @@ void* tu58_monitor(void* none) {
 			error("monitor(): unknown flag %d", sts);
 			break;
 		}
-		now = now_ms();
-		// image_*() routines have, mutex locking, so no change while saving possible
-		if (next_sync_time < now
-				&& tu58_serial.rx_lasttime_ms + opt_synctimeout_sec * 1000 < now
-				&& tu58_serial.tx_lasttime_ms + opt_synctimeout_sec * 1000 < now) {
-			// next sync time passed, and RS232 inactive
-			tu58images_sync_all();
-			next_sync_time = now + opt_synctimeout_sec * 1000;
-		}
-
 		// bit of a delay, loop again
 		delay_ms(5);
 
@@ -76,9 +76,10 @@ extern volatile int	tu58_offline ; // TU58 is offline, all drives without cartri
 
 void tu58images_init(void) ;
 image_t *tu58image_create(int32_t unit, int forced_data_size) ;
+int tu58image_open(int32_t unit, int shared, int readonly, int allowcreate, char *fname,
+		filesystem_type_t dec_filesystem) ;
 image_t *tu58image_get(int32_t unit) ;
 void tu58images_closeall(void);
-void tu58images_sync_all();
 
 
 void* tu58_server (void* none) ;
@@ -33,6 +33,8 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026  JH  table driven RAD-50 and DOS-11 date codecs, caller buffers
+ *  18-Oct-2026  JH  result buffers per thread
  *  07-May-2017  JH  passes GCC warning levels -Wall -Wextra
  *  20-Jan-2017  JH  created
  */
@@ -112,12 +114,12 @@ int timeout_reached() {
 
 
 char *cur_time_text() {
-	static char result[40] ;
+	static THREAD_LOCAL char result[40] ;
 	time_t timer;
-	struct tm* tm_info;
+	struct tm tm_info;
 	time(&timer);
-	tm_info = localtime(&timer);
-	strftime(result, 26, "%H:%M:%S", tm_info);
+	localtime_r(&timer, &tm_info);
+	strftime(result, 26, "%H:%M:%S", &tm_info);
 	return result;
 }
 
@@ -163,10 +165,38 @@ int file_write(char *fpath, uint8_t *data, unsigned size) {
 }
 
 
+// fast non-cryptographic hash over a memory block (FNV-1a, 64 bit)
+// Start with "hash" = MEMHASH_INIT, chain several blocks by passing the last result.
+uint64_t memhash(void *data, uint32_t size, uint64_t hash) {
+	uint8_t *s = data;
+	while (size--) {
+		hash ^= *s++;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// hash over the content of a file, see memhash()
+int file_hash(char *fpath, uint64_t *hash) {
+	uint8_t buff[65536];
+	ssize_t n;
+	int fd;
+	fd = open(fpath, O_RDONLY);
+	if (fd < 0)
+		return error_set(ERROR_HOSTFILE, "File hash: can not open \"%s\"", fpath);
+	*hash = MEMHASH_INIT;
+	while ((n = read(fd, buff, sizeof(buff))) > 0)
+		*hash = memhash(buff, n, *hash);
+	close(fd);
+	if (n < 0)
+		return error_set(ERROR_HOSTFILE, "File hash: can not read \"%s\"", fpath);
+	return ERROR_OK;
+}
+
 // read a string and separate into tokens
 // return: count
 int inputline(char **tokenlist, int tokenlist_size) {
-	static char buffer[1024];
+	static THREAD_LOCAL char buffer[1024];
 	int n;
 	char *t;
 
@@ -184,7 +214,7 @@ int inputline(char **tokenlist, int tokenlist_size) {
 
 // return result from big static buffer
 char *strtrim(char *txt) {
-	static char buff[1024];
+	static THREAD_LOCAL char buff[1024];
 	char *s = txt; // start
 
 	assert(strlen(txt) < sizeof(buff));
@@ -201,9 +231,21 @@ char *strtrim(char *txt) {
 	return buff;
 }
 
+// hash over a string, for name index tables.
+// Case and white space are ignored, so padded PDP names hash like trimmed host names.
+// Start with "hash" = STRHASH_INIT, chain several strings by passing the last result.
+uint32_t strhash(char *s, uint32_t hash) {
+	for (; *s; s++)
+		if (!isspace((unsigned char) *s)) {
+			hash ^= (uint8_t) toupper((unsigned char) *s); // FNV-1a
+			hash *= 16777619;
+		}
+	return hash;
+}
+
 // pad a string right upto "len" with char "c"
 char *strrpad(char *txt, int len, char c) {
-	static char buff[1024];
+	static THREAD_LOCAL char buff[1024];
 	memset(buff, c, len); // init buffer with base pattern
 	strncpy(buff, txt, strlen(txt));
 	buff[len] = 0;
@@ -212,7 +254,7 @@ char *strrpad(char *txt, int len, char c) {
 
 // string with all invisible chars in \x notation
 char *strprintable(char *s, int size) {
-	static char buffer[1024] ;
+	static THREAD_LOCAL char buffer[1024] ;
 	char buf[10] ;
 	int i ;
 	char c ;
@@ -249,77 +291,71 @@ char *strprintable(char *s, int size) {
 }
 
 
-// encode char into a 0..39 value
+// RAD-50 value of each char. lower case letters as upper case, invalid = %
 // " ABCDEFGHIJKLMNOPQRSTUVWXYZ$.%0123456789"
-// invalid = %
 // see https://en.wikipedia.org/wiki/DEC_Radix-50#16-bit_systems
-static int rad50_chr2val(int c) {
-	if (c == ' ')
-		return 000;
-	else if (c >= 'A' && c <= 'Z')
-		/// => 000001..011010
-		return 1 + c - 'A';
-	else if (c == '$')
-		return 033;
-	else if (c == '.')
-		return 034;
-	else if (c == '%')
-		return 035;
-	else if (c >= '0' && c <= '9')
-		return 036 + c - '0';
-	else
-		return 035; // RT-11 for "invalid"
-}
-
-static int rad50_val2chr(int val) {
-	if (val == 000)
-		return ' ';
-	else if (val >= 001 && val <= 032)
-		return 'A' + val - 001;
-	else if (val == 033)
-		return '$';
-	else if (val == 034)
-		return '.';
-	else if (val == 035)
-		return '%';
-	else if (val >= 036 && val <= 047)
-		return '0' + val - 036;
-	else
-		return '%'; // RT-11 for "invalid"
-}
-
-// convert 3 chars in RAD-50 encoding to a string
+static const uint8_t rad50_val[256] = {
+		035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, // 0x00
+		035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, // 0x10
+		000, 035, 035, 035, 033, 035, 035, 035, 035, 035, 035, 035, 035, 035, 034, 035, // 0x20
+		036, 037, 040, 041, 042, 043, 044, 045, 046, 047, 035, 035, 035, 035, 035, 035, // 0x30
+		035, 001, 002, 003, 004, 005, 006, 007, 010, 011, 012, 013, 014, 015, 016, 017, // 0x40
+		020, 021, 022, 023, 024, 025, 026, 027, 030, 031, 032, 035, 035, 035, 035, 035, // 0x50
+		035, 001, 002, 003, 004, 005, 006, 007, 010, 011, 012, 013, 014, 015, 016, 017, // 0x60
+		020, 021, 022, 023, 024, 025, 026, 027, 030, 031, 032, 035, 035, 035, 035, 035, // 0x70
+		035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, // 0x80
+		035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, // 0x90
+		035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, // 0xa0
+		035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, // 0xb0
+		035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, // 0xc0
+		035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, // 0xd0
+		035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, // 0xe0
+		035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, 035, // 0xf0
+};
+
+// char of each RAD-50 value. 050 = overflow of highest digit, RT-11 "invalid"
+static const char rad50_chr[050 + 2] = " ABCDEFGHIJKLMNOPQRSTUVWXYZ$.%0123456789%";
+
+// convert 3 chars in RAD-50 encoding into buff[4]
 // letters are digits in a base 40 (octal "50") number system
 // highest digit = left most letter
-char *rad50_decode(uint16_t w) {
-	static char result[4];
-	result[2] = rad50_val2chr(w % 050);
-	w /= 050;
-	result[1] = rad50_val2chr(w % 050);
-	w /= 050;
-	result[0] = rad50_val2chr(w);
-	result[3] = 0;
-	return result;
+char *rad50_decode(uint16_t w, char *buff) {
+	buff[0] = rad50_chr[w / (050 * 050)];
+	buff[1] = rad50_chr[(w / 050) % 050];
+	buff[2] = rad50_chr[w % 050];
+	buff[3] = 0;
+	return buff;
 }
 
+// encode up to 3 chars of s, missing chars are spaces
 uint16_t rad50_encode(char *s) {
 	uint16_t result = 0;
-	int n;
+	int i;
 	if (!s)
 		return 0; // 3 spaces
-
-	n = strlen(s);
-	if (n > 0)
-		result += rad50_chr2val(toupper(s[0]));
-	result *= 050;
-	if (n > 1)
-		result += rad50_chr2val(toupper(s[1]));
-	result *= 050;
-	if (n > 2)
-		result += rad50_chr2val(toupper(s[2]));
+	for (i = 0; i < 3; i++) {
+		result *= 050;
+		if (*s)
+			result += rad50_val[(uint8_t) *s++];
+	}
 	return result;
 }
 
+// decode the 3 words of a directory entry name into
+// filnam[7] (6 chars) and ext[4] (3 chars). Trailing spaces are kept
+void rad50_decode_filename(uint16_t *w, char *filnam, char *ext) {
+	rad50_decode(w[0], filnam);
+	rad50_decode(w[1], filnam + 3);
+	rad50_decode(w[2], ext);
+}
+
+// encode filnam (max 6 chars) and ext (max 3 chars) into 3 words
+void rad50_encode_filename(char *filnam, char *ext, uint16_t *w) {
+	w[0] = rad50_encode(filnam);
+	w[1] = strlen(filnam) > 3 ? rad50_encode(filnam + 3) : 0;
+	w[2] = rad50_encode(ext);
+}
+
 // 1, if path/filename exists
 int file_exists(char *path, char *filename) {
 	char buffer[4096];
@@ -356,52 +392,54 @@ int leapyear(int y) {
 	return ((y % 4 == 0) && (y % 100 != 0)) || (y % 400 == 0);
 }
 
-int monthlen_noleap[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
-int monthlen_leap[] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
-
-// convert a DOS-11 data to time_t
-// day = 5 bits, month= 4bits, year = 9bits
-struct tm dos11date_decode(uint16_t w) {
-	int *monthlen;
-	struct tm result;
-	int y = (w / 1000) + 1970;
-	int m;
-	int d = w % 1000; // starts as day of year
-
-	memset(&result, 0, sizeof(result)); //clear
-
-	// use correct table
-	monthlen = leapyear(y) ? monthlen_leap : monthlen_noleap;
+// day of year before 1st of month, [leap][month]. [12] = days in year
+static const uint16_t dos11date_doy[2][13] = { //
+		{ 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365 }, //
+		{ 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366 } };
+
+// convert DOS-11 dates into struct tm
+// date = 1000 * (year - 1970) + day of year
+// DOS-11 years run 1970..2035, there every 4th year is a leap year
+void dos11date_decode_array(uint16_t *w, struct tm *t, int count) {
+	const uint16_t *doy;
+	int d, m;
+	for (; count > 0; count--, w++, t++) {
+		int y = *w / 1000 + 1970;
+		d = *w % 1000; // starts as day of year
+		doy = dos11date_doy[(y & 3) == 0];
+		// month is (d-1)/31 or one more
+		m = d ? (d - 1) / 31 : 0;
+		if (m < 12 && d > doy[m + 1])
+			m++;
+		if (m > 11)
+			m = 11; // invalid day of year: beyond December 31
+		memset(t, 0, sizeof(*t));
+		t->tm_year = y - 1900;
+		t->tm_mon = m; // 0..11
+		t->tm_mday = d - doy[m]; // 1..31
+	}
+}
 
-	m = 0;
-	while (d > monthlen[m]) {
-		d -= monthlen[m];
-		m++;
+// convert struct tm into DOS-11 dates
+void dos11date_encode_array(struct tm *t, uint16_t *w, int count) {
+	int y, m;
+	for (; count > 0; count--, w++, t++) {
+		y = 1900 + t->tm_year; // year is easy
+		m = t->tm_mon < 0 ? 0 : t->tm_mon > 11 ? 11 : t->tm_mon;
+		*w = 1000 * (y - 1970) + dos11date_doy[(y & 3) == 0][m] + t->tm_mday;
 	}
-	result.tm_year = y - 1900;
-	result.tm_mon = m; // 0..11
-	result.tm_mday = d; // 1..31
+}
 
-	assert(w == dos11date_encode(result)); // cross check
+// single date
+struct tm dos11date_decode(uint16_t w) {
+	struct tm result;
+	dos11date_decode_array(&w, &result, 1);
 	return result;
 }
 
-// year after allowed: trunc to this.
-int dos11date_overflow_year = 1999;
 uint16_t dos11date_encode(struct tm t) {
-	int *monthlen;
-	uint16_t result = 0;
-	int doy;
-	int y = 1900 + t.tm_year; // year is easy
-	int m;
-
-	monthlen = leapyear(y) ? monthlen_leap : monthlen_noleap;
-
-	for (doy = m = 0; m < t.tm_mon; m++)
-		doy += monthlen[m];
-
-	result = doy + t.tm_mday;
-	result += 1000 * (y - 1970);
+	uint16_t result;
+	dos11date_encode_array(&t, &result, 1);
 	return result;
 }
 
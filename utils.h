@@ -33,6 +33,7 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026  JH  table driven RAD-50 and DOS-11 date codecs, caller buffers
  *  07-May-2017  JH  passes GCC warning levels -Wall -Wextra
  *  20-Jan-2017  JH  created
  */
@@ -48,6 +49,9 @@
 // http://stackoverflow.com/questions/1486904/how-do-i-best-silence-a-warning-about-unused-variables
 #define UNUSED(expr) do { (void)(expr); } while (0)
 
+// static result buffers, which must not be shared by parallel sync workers
+#define THREAD_LOCAL	__thread
+
 
 // how many blocks are needed to hold "byte_count" bytes?
 #define NEEDED_BLOCKS(blocksize,byte_count) ( ((byte_count)+(blocksize)-1) / (blocksize) )
@@ -69,17 +73,26 @@ char *cur_time_text(void) ;
 int is_memset(void *ptr, uint8_t val, uint32_t size);
 int is_fileset(char *fpath, uint8_t val, uint32_t offset);
 int file_write(char *fpath, uint8_t *data, unsigned size) ;
+#define MEMHASH_INIT	14695981039346656037ull
+uint64_t memhash(void *data, uint32_t size, uint64_t hash);
+int file_hash(char *fpath, uint64_t *hash);
 
 
 char *strtrim(char *txt);
 char *strrpad(char *txt, int len, char c);
+#define STRHASH_INIT	2166136261u
+uint32_t strhash(char *s, uint32_t hash);
 int inputline(char **tokenlist, int tokenlist_size);
 char *strprintable(char *s, int size) ;
 
-char *rad50_decode(uint16_t w);
+char *rad50_decode(uint16_t w, char *buff);
 uint16_t rad50_encode(char *s);
+void rad50_decode_filename(uint16_t *w, char *filnam, char *ext);
+void rad50_encode_filename(char *filnam, char *ext, uint16_t *w);
 struct tm dos11date_decode(uint16_t w);
 uint16_t dos11date_encode(struct tm t);
+void dos11date_decode_array(uint16_t *w, struct tm *t, int count);
+void dos11date_encode_array(struct tm *t, uint16_t *w, int count);
 
 // 1, if path/filename exists
 int file_exists(char *path, char *filename) ;
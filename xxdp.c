@@ -33,6 +33,15 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026  JH  RAD-50 filename codec from utils
+ *  18-Oct-2026  JH  file index of blocks
+ *  18-Oct-2026  JH  files allocated from arena
+ *  18-Oct-2026  JH  file data loaded on demand, not on parse
+ *  18-Oct-2026  JH  block lists allocated dynamically, no 1024 block file limit
+ *  18-Oct-2026  JH  bitmap packed into words, popcount
+ *  18-Oct-2026  JH  directory blocks reported for sync trigger
+ *  18-Oct-2026  JH  file data can be borrowed from caller
+ *  18-Oct-2026  JH  update/delete single files in parsed image
  *  07-May-2017  JH  passes GCC warning levels -Wall -Wextra
  *  20-Jan-2017  JH  created
  *
@@ -120,22 +129,60 @@ static void xxdp_image_set_word(xxdp_filesystem_t *_this, xxdp_blocknr_t blocknr
 	//fprintf(stderr, "set 0x%x to 0x%x\n", idx, val) ;
 }
 
+/*
+ * block lists: array grows on demand, so small files need little memory
+ */
+static void xxdp_blocklist_init(xxdp_blocklist_t *bl) {
+	bl->count = 0;
+	bl->capacity = 0;
+	bl->blocknr = NULL;
+}
+
+static void xxdp_blocklist_free(xxdp_blocklist_t *bl) {
+	free(bl->blocknr);
+	xxdp_blocklist_init(bl);
+}
+
+// append a block at the end
+static void xxdp_blocklist_add(xxdp_blocklist_t *bl, xxdp_blocknr_t blocknr) {
+	if (bl->count == bl->capacity) {
+		bl->capacity = bl->capacity ? 2 * bl->capacity : 16;
+		bl->blocknr = realloc(bl->blocknr, bl->capacity * sizeof(xxdp_blocknr_t));
+	}
+	bl->blocknr[bl->count++] = blocknr;
+}
+
 // scan linked list at block # 'start'
 // bytes 0,1 = 1st word in block are # of next. Last blck has link "0".
+// A corrupt chain ends at a link outside the filesystem, or at a block already
+// in the list. Then the list holds the valid blocks before.
 static int xxdp_blocklist_get(xxdp_filesystem_t *_this, xxdp_blocklist_t *bl,
 		xxdp_blocknr_t start) {
 	xxdp_blocknr_t blocknr = start;
-	unsigned n = 0; // count blocks
+	unsigned i;
+	int result = ERROR_OK;
+	bl->count = 0;
 	do {
-		bl->blocknr[n++] = blocknr;
+		if (blocknr >= _this->blockcount
+				|| (blocknr + 1) * XXDP_BLOCKSIZE > _this->image_size) {
+			result = error_set(ERROR_FILESYSTEM_FORMAT,
+					"xxdp_blocklist_get(): link to block %u outside filesystem", blocknr);
+			break;
+		}
+		if (BOOLARRAY_BIT_GET(_this->chain_visited, blocknr)) {
+			result = error_set(ERROR_FILESYSTEM_FORMAT,
+					"xxdp_blocklist_get(): block list recursion at block %u", blocknr);
+			break;
+		}
+		boolarray_bit_set(_this->chain_visited, blocknr);
+		xxdp_blocklist_add(bl, blocknr);
 		// follwo link to next block
 		blocknr = xxdp_image_get_word(_this, blocknr, 0);
-	} while (n < XXDP_MAX_BLOCKS_PER_LIST && blocknr > 0);
-	bl->count = n;
-	if (blocknr)
-		return error_set(ERROR_FILESYSTEM_FORMAT,
-				"xxdp_blocklist_get(): block list too long or recursion");
-	return ERROR_OK;
+	} while (blocknr > 0);
+	// clear only the bits set
+	for (i = 0; i < bl->count; i++)
+		boolarray_bit_clear(_this->chain_visited, bl->blocknr[i]);
+	return result;
 }
 
 static void xxdp_blocklist_set(xxdp_filesystem_t *_this, xxdp_blocklist_t *bl) {
@@ -150,25 +197,54 @@ static void xxdp_blocklist_set(xxdp_filesystem_t *_this, xxdp_blocklist_t *bl) {
 // get count of used blocks
 static int xxdp_bitmap_count(xxdp_filesystem_t *_this) {
 	int result = 0;
-	unsigned i, j, k;
+	unsigned i, j;
 	for (i = 0; i < _this->bitmap->blocklist.count; i++) {
 		xxdp_blocknr_t map_blknr = _this->bitmap->blocklist.blocknr[i];
 		unsigned map_wordcount;
 		map_wordcount = xxdp_image_get_word(_this, map_blknr, 2);
-		for (j = 0; j < map_wordcount; j++) {
-			uint16_t map_flags = xxdp_image_get_word(_this, map_blknr, j + 4);
-			// 16 flags per word. count "1" bits
-			if (map_flags == 0xffff)
-				result += 16; // most of time
-			else
-				for (k = 0; k < 16; k++)
-					if (map_flags & (1 << k))
-						result++;
-		}
+		// 16 flags per word. count "1" bits
+		for (j = 0; j < map_wordcount; j++)
+			result += __builtin_popcount(xxdp_image_get_word(_this, map_blknr, j + 4));
 	}
 	return result;
 }
 
+/*
+ * "used" flags of the block bitmap, 16 per word
+ */
+#define BITMAP_USED(bitmap,blknr) ( !!((bitmap)->used[(blknr) / 16] & (1 << ((blknr) % 16))) )
+
+static void xxdp_bitmap_set(xxdp_bitmap_t *bitmap, unsigned blknr, int used) {
+	if (used)
+		bitmap->used[blknr / 16] |= (1 << (blknr % 16));
+	else
+		bitmap->used[blknr / 16] &= ~(1 << (blknr % 16));
+}
+
+// mark blocks start..start+count-1 as used, whole words at once
+static void xxdp_bitmap_set_range(xxdp_bitmap_t *bitmap, unsigned start, unsigned count) {
+	unsigned end = start + count;
+	while (start < end && start % 16)
+		xxdp_bitmap_set(bitmap, start++, 1);
+	for (; start + 16 <= end; start += 16)
+		bitmap->used[start / 16] = 0xffff;
+	while (start < end)
+		xxdp_bitmap_set(bitmap, start++, 1);
+}
+
+// first unused block in start..end-1. end if none
+static unsigned xxdp_bitmap_find_free(xxdp_bitmap_t *bitmap, unsigned start, unsigned end) {
+	while (start < end) {
+		uint16_t free_flags = ~bitmap->used[start / 16] & (0xffff << (start % 16));
+		if (free_flags) {
+			start = (start & ~15u) + __builtin_ctz(free_flags);
+			return start < end ? start : end;
+		}
+		start = (start & ~15u) + 16; // next word
+	}
+	return end;
+}
+
 // calculate new layout params in_this->radi from block_count
 // _this.radi must be already intialized for device,
 static int xxdp_filesystem_recalc_radi(xxdp_filesystem_t *_this) {
@@ -282,10 +358,15 @@ xxdp_filesystem_t *xxdp_filesystem_create(device_type_t dec_device, uint8_t *ima
 	_this->monitor->data = NULL;
 	_this->monitor->data_size = 0;
 	_this->bitmap = malloc(sizeof(xxdp_bitmap_t));
+	xxdp_blocklist_init(&_this->bitmap->blocklist);
 	_this->mfd_blocklist = malloc(sizeof(xxdp_blocklist_t));
+	xxdp_blocklist_init(_this->mfd_blocklist);
 	_this->ufd_blocklist = malloc(sizeof(xxdp_blocklist_t));
+	xxdp_blocklist_init(_this->ufd_blocklist);
+	_this->chain_visited = boolarray_create(XXDP_MAX_BLOCKCOUNT);
 
-	// files vary: dynamic allocate
+	// files vary: allocated from arena, all released by init()
+	_this->arena = arena_create(64 * 1024);
 	_this->file_count = 0;
 	for (file_idx = 0; file_idx < XXDP_MAX_FILES_PER_IMAGE; file_idx++)
 		_this->file[file_idx] = NULL;
@@ -297,9 +378,14 @@ void xxdp_filesystem_destroy(xxdp_filesystem_t *_this) {
 	xxdp_filesystem_init(_this); // free files
 	free(_this->bootblock);
 	free(_this->monitor);
+	xxdp_blocklist_free(&_this->bitmap->blocklist);
 	free(_this->bitmap);
+	xxdp_blocklist_free(_this->mfd_blocklist);
 	free(_this->mfd_blocklist);
+	xxdp_blocklist_free(_this->ufd_blocklist);
 	free(_this->ufd_blocklist);
+	boolarray_destroy(_this->chain_visited);
+	arena_destroy(_this->arena);
 	free(_this);
 }
 
@@ -309,8 +395,7 @@ void xxdp_filesystem_init(xxdp_filesystem_t *_this) {
 
 	// empty block bitmap
 	_this->bitmap->blocklist.count = 0; // position not known
-	for (i = 0; i < XXDP_MAX_BLOCKCOUNT; i++)
-		_this->bitmap->used[i] = 0;
+	memset(_this->bitmap->used, 0, sizeof(_this->bitmap->used));
 
 	// set device params
 	// _this->blockcount = _this->radi->blocks_num;
@@ -330,13 +415,11 @@ void xxdp_filesystem_init(xxdp_filesystem_t *_this) {
 	// which sort of MFD?
 	if (_this->radi.mfd2 >= 0) {
 		_this->mfd_variety = 1; // 2 blocks
-		_this->mfd_blocklist->count = 2;
-		_this->mfd_blocklist->blocknr[0] = _this->radi.mfd1;
-		_this->mfd_blocklist->blocknr[1] = _this->radi.mfd2;
+		xxdp_blocklist_add(_this->mfd_blocklist, _this->radi.mfd1);
+		xxdp_blocklist_add(_this->mfd_blocklist, _this->radi.mfd2);
 	} else {
 		_this->mfd_variety = 2; // single block format
-		_this->mfd_blocklist->count = 1;
-		_this->mfd_blocklist->blocknr[0] = _this->radi.mfd1;
+		xxdp_blocklist_add(_this->mfd_blocklist, _this->radi.mfd1);
 	}
 	_this->ufd_blocklist->count = 0;
 	if (_this->bootblock->data)
@@ -350,14 +433,22 @@ void xxdp_filesystem_init(xxdp_filesystem_t *_this) {
 
 	for (i = 0; i < XXDP_MAX_FILES_PER_IMAGE; i++)
 		if (_this->file[i]) {
-			if (_this->file[i]->data)
+			if (_this->file[i]->data && !_this->file[i]->borrowed)
 				free(_this->file[i]->data);
-			free(_this->file[i]);
+			xxdp_blocklist_free(&_this->file[i]->blocklist);
 			_this->file[i] = NULL;
 		}
+	arena_reset(_this->arena);
 	_this->file_count = 0;
 }
 
+// blocks available for the monitor: from its start to end of preallocated area
+static unsigned xxdp_monitor_max_blockcount(xxdp_filesystem_t *_this) {
+	if (_this->monitor->blocknr > _this->preallocated_blockcount)
+		return 0; // corrupt MFD
+	return _this->preallocated_blockcount - _this->monitor->blocknr;
+}
+
 /**************************************************************
  * _parse()
  * convert byte array of image into logical objects
@@ -389,15 +480,15 @@ static void parse_mfd(xxdp_filesystem_t *_this) {
 		// a 0 terminated list of bitmap blocks is in MFD1, word 2,3,...
 		// Prefer MFD data over linked list scan, why?
 		n = 0;
+		_this->bitmap->blocklist.count = 0;
 		do {
 			assert(n + 3 < 255);
 			blknr = xxdp_image_get_word(_this, mfdblknr, n + 3);
 			if (blknr > 0) {
-				_this->bitmap->blocklist.blocknr[n] = blknr;
+				xxdp_blocklist_add(&_this->bitmap->blocklist, blknr);
 				n++;
 			}
 		} while (blknr > 0);
-		_this->bitmap->blocklist.count = n;
 
 		mfdblknr = _this->mfd_blocklist->blocknr[1];
 		// Get start of User File Directory from MFD2, word 2, then scan linked list
@@ -450,7 +541,7 @@ static void parse_mfd(xxdp_filesystem_t *_this) {
 		if (n != _this->radi.monitor_block)
 			warning("Monitor core start is %u in RADI, but %d in MFD1/2",
 					_this->radi.monitor_block, n);
-		_this->monitor->blockcount = _this->preallocated_blockcount - _this->monitor->blocknr;
+		_this->monitor->blockcount = xxdp_monitor_max_blockcount(_this);
 
 		warning("Position of bad block file not yet evaluated");
 	} else
@@ -459,8 +550,8 @@ static void parse_mfd(xxdp_filesystem_t *_this) {
 
 // bitmap blocks known, produce "used[]" flag array
 static void parse_bitmap(xxdp_filesystem_t *_this) {
-	unsigned i, j, k;
-	xxdp_blocknr_t blknr; // enumerates the block flags
+	unsigned i, j;
+	unsigned blknr; // enumerates the block flags
 	// assume consecutive bitmap blocks encode consecutive block numbers
 	// what about map number?
 	blknr = 0;
@@ -475,17 +566,10 @@ static void parse_bitmap(xxdp_filesystem_t *_this) {
 		map_start_blknr = xxdp_image_get_word(_this, map_blknr, 3);
 		assert(map_start_blknr == _this->bitmap->blocklist.blocknr[0]);
 		// hexdump(ferr, IMAGE_BLOCKNR2PTR(_this, map_blknr), 512, "Block %u = bitmap %u", map_blknr, i);
-		for (j = 0; j < map_wordcount; j++) {
-			uint16_t map_flags = xxdp_image_get_word(_this, map_blknr, j + 4);
-			// 16 flags per word. LSB = lowest blocknr
-			for (k = 0; k < 16; k++) {
-				assert(blknr == (i * XXDP_BITMAP_WORDS_PER_MAP + j) * 16 + k);
-				if (map_flags & (1 << k))
-					_this->bitmap->used[blknr] = 1;
-				else
-					_this->bitmap->used[blknr] = 0;
-				blknr++;
-			}
+		// 16 flags per word. LSB = lowest blocknr, same as used[]
+		for (j = 0; j < map_wordcount && blknr < XXDP_MAX_BLOCKCOUNT; j++, blknr += 16) {
+			assert(blknr == (i * XXDP_BITMAP_WORDS_PER_MAP + j) * 16);
+			_this->bitmap->used[blknr / 16] = xxdp_image_get_word(_this, map_blknr, j + 4);
 		}
 	}
 	// blknr is now count of defined blocks
@@ -508,9 +592,17 @@ static int parse_ufd(xxdp_filesystem_t *_this) {
 	xxdp_blocknr_t blknr; // enumerates the directory blocks
 	uint32_t file_entry_start_wordnr;
 	uint16_t w;
+	uint16_t name_words[3];
+	uint16_t date_words[XXDP_UFD_ENTRIES_PER_BLOCK];
+	struct tm dates[XXDP_UFD_ENTRIES_PER_BLOCK];
 	for (i = 0; i < _this->ufd_blocklist->count; i++) {
 		blknr = _this->ufd_blocklist->blocknr[i];
 		// hexdump(ferr, IMAGE_BLOCKNR2PTR(_this, blknr), 512, "Block %u = UFD block %u", blknr, i);
+		// dates of all entries in block
+		for (j = 0; j < XXDP_UFD_ENTRIES_PER_BLOCK; j++)
+			date_words[j] = xxdp_image_get_word(_this, blknr,
+					1 + j * XXDP_UFD_ENTRY_WORDCOUNT + 3);
+		dos11date_decode_array(date_words, dates, XXDP_UFD_ENTRIES_PER_BLOCK);
 		// 28 dir entries per block
 		for (j = 0; j < XXDP_UFD_ENTRIES_PER_BLOCK; j++) {
 			xxdp_file_t *f;
@@ -520,25 +612,29 @@ static int parse_ufd(xxdp_filesystem_t *_this) {
 			if (w == 0)
 				continue; // invalid entry
 			// create file entry
-			f = malloc(sizeof(xxdp_file_t));
+			f = arena_alloc(_this->arena, sizeof(xxdp_file_t));
 			f->data = NULL; //
+			f->borrowed = 0;
+			xxdp_blocklist_init(&f->blocklist);
 			f->filnam[0] = 0;
 			f->changed = 0;
 			f->fixed = 0;
-			// filnam: 6 chars
-			strcat(f->filnam, rad50_decode(w));
-			w = xxdp_image_get_word(_this, blknr, file_entry_start_wordnr + 1);
-			strcat(f->filnam, rad50_decode(w));
-			// extension: 3 chars
-			w = xxdp_image_get_word(_this, blknr, file_entry_start_wordnr + 2);
-			strcpy(f->ext, rad50_decode(w));
+			// filnam: 6 chars, extension: 3 chars
+			name_words[0] = w;
+			name_words[1] = xxdp_image_get_word(_this, blknr, file_entry_start_wordnr + 1);
+			name_words[2] = xxdp_image_get_word(_this, blknr, file_entry_start_wordnr + 2);
+			rad50_decode_filename(name_words, f->filnam, f->ext);
 
-			w = xxdp_image_get_word(_this, blknr, file_entry_start_wordnr + 3);
-			f->date = dos11date_decode(w);
+			f->date = dates[j];
 
 			// start block, scan blocklist
 			w = xxdp_image_get_word(_this, blknr, file_entry_start_wordnr + 5);
 			xxdp_blocklist_get(_this, &(f->blocklist), w);
+			if (f->blocklist.count == 0) {
+				warning("XXDP UFD read: file %s.%s: invalid start block %u, ignored.",
+						f->filnam, f->ext, w);
+				continue;
+			}
 
 			// check: filelen?
 			f->block_count = xxdp_image_get_word(_this, blknr, file_entry_start_wordnr + 6);
@@ -559,15 +655,14 @@ static int parse_ufd(xxdp_filesystem_t *_this) {
 	return ERROR_OK ;
 }
 
-// load and allocate file data from blocklist
-// da is read in 510 byte chunks, actual size not known
-static void parse_file_data(xxdp_filesystem_t *_this, xxdp_file_t *f) {
+// gather data of a parsed file from the payload of its blocks.
+// Must be called before the blocks are rewritten.
+static void xxdp_file_load(xxdp_filesystem_t *_this, xxdp_file_t *f) {
 	unsigned i;
 	unsigned block_datasize = XXDP_BLOCKSIZE - 2; // data amount in block, after link word
 	uint8_t *src, *dst;
 	if (f->data)
-		free(f->data);
-	f->data_size = f->blocklist.count * block_datasize;
+		return; // not parsed, or already loaded
 	f->data = malloc(f->data_size);
 	dst = f->data;
 	for (i = 0; i < f->blocklist.count; i++) {
@@ -591,15 +686,16 @@ int xxdp_filesystem_parse(xxdp_filesystem_t *_this) {
 	parse_stream(_this, _this->bootblock, _this->bootblock->blocknr, 1);
 	// read monitor: from defined start until end of preallocated area, about 32
 	parse_stream(_this, _this->monitor, _this->monitor->blocknr,
-			_this->preallocated_blockcount - _this->monitor->blocknr);
+			xxdp_monitor_max_blockcount(_this));
 
 	parse_mfd(_this);
 	parse_bitmap(_this);
 	parse_ufd(_this);
 
-	// read data for all user files
+	// size of all user files. Data is loaded on demand: parse is called on every sync.
+	// da is read in 510 byte chunks, actual size not known
 	for (i = 0; i < _this->file_count; i++)
-		parse_file_data(_this, _this->file[i]);
+		_this->file[i]->data_size = _this->file[i]->blocklist.count * (XXDP_BLOCKSIZE - 2);
 
 	xxdp_filesystem_mark_files_as_changed(_this);
 
@@ -654,8 +750,7 @@ static int xxdp_filesystem_layout(xxdp_filesystem_t *_this) {
 	// mark preallocated blocks in bitmap
 	// this covers boot, monitor, bitmap, mfd and default sized ufd
 	memset(_this->bitmap->used, 0, sizeof(_this->bitmap->used));
-	for (i = 0; i < _this->preallocated_blockcount; i++)
-		_this->bitmap->used[i] = 1;
+	xxdp_bitmap_set_range(_this->bitmap, 0, _this->preallocated_blockcount);
 
 	// BOOT
 	if (_this->bootblock->data_size) {
@@ -677,23 +772,21 @@ static int xxdp_filesystem_layout(xxdp_filesystem_t *_this) {
 	// BITMAP
 	n = _this->radi.bitmaps_num;
 	blknr = _this->radi.bitmap_block_1; // set start
-	for (i = 0; i < n; i++) { // enumerate sequential
-		_this->bitmap->used[blknr] = 1;
-		_this->bitmap->blocklist.blocknr[i] = blknr++;
-	}
-	_this->bitmap->blocklist.count = n;
+	xxdp_bitmap_set_range(_this->bitmap, blknr, n);
+	_this->bitmap->blocklist.count = 0;
+	for (i = 0; i < n; i++) // enumerate sequential
+		xxdp_blocklist_add(&_this->bitmap->blocklist, blknr++);
 
 	// MFD
+	_this->mfd_blocklist->count = 0;
 	if (_this->mfd_variety == 1) {
-		_this->mfd_blocklist->count = 2;
-		_this->mfd_blocklist->blocknr[0] = _this->radi.mfd1;
-		_this->mfd_blocklist->blocknr[1] = _this->radi.mfd2;
-		_this->bitmap->used[_this->radi.mfd1] = 1;
-		_this->bitmap->used[_this->radi.mfd2] = 1;
+		xxdp_blocklist_add(_this->mfd_blocklist, _this->radi.mfd1);
+		xxdp_blocklist_add(_this->mfd_blocklist, _this->radi.mfd2);
+		xxdp_bitmap_set(_this->bitmap, _this->radi.mfd1, 1);
+		xxdp_bitmap_set(_this->bitmap, _this->radi.mfd2, 1);
 	} else if (_this->mfd_variety == 2) {
-		_this->mfd_blocklist->count = 1;
-		_this->mfd_blocklist->blocknr[0] = _this->radi.mfd1;
-		_this->bitmap->used[_this->radi.mfd1] = 1;
+		xxdp_blocklist_add(_this->mfd_blocklist, _this->radi.mfd1);
+		xxdp_bitmap_set(_this->bitmap, _this->radi.mfd1, 1);
 	} else
 	fatal("MFD variety must be 1 or 2");
 	// UFD
@@ -701,20 +794,22 @@ static int xxdp_filesystem_layout(xxdp_filesystem_t *_this) {
 	n = NEEDED_BLOCKS(XXDP_UFD_ENTRIES_PER_BLOCK, _this->file_count);
 	if (n < _this->radi.ufd_blocks_num)
 		n = _this->radi.ufd_blocks_num; // RADI defines minimum
-	_this->ufd_blocklist->count = n;
+	_this->ufd_blocklist->count = 0;
 	// last UFD half filled
 	blknr = _this->radi.ufd_block_1;	// start
 	i = 0;
 	// 1) fill UFD into preallocated space
 	while (i < n && i < _this->radi.ufd_blocks_num) {
-		_this->bitmap->used[blknr] = 1;
-		_this->ufd_blocklist->blocknr[i++] = blknr++;
+		xxdp_bitmap_set(_this->bitmap, blknr, 1);
+		xxdp_blocklist_add(_this->ufd_blocklist, blknr++);
+		i++;
 	}
 	// 2) continue in free space, if larger than RADI defines
 	blknr = _this->preallocated_blockcount; // 1st in free space
 	while (i < n) {
-		_this->bitmap->used[blknr] = 1;
-		_this->ufd_blocklist->blocknr[i++] = blknr++;
+		xxdp_bitmap_set(_this->bitmap, blknr, 1);
+		xxdp_blocklist_add(_this->ufd_blocklist, blknr++);
+		i++;
 	}
 	// blknr now 1st block behind UFD.
 
@@ -730,22 +825,18 @@ static int xxdp_filesystem_layout(xxdp_filesystem_t *_this) {
 		// amount of 510 byte blocks
 		n = NEEDED_BLOCKS(XXDP_BLOCKSIZE-2, f->data_size);
 // fprintf(stderr,"layout(): file %d %s.%s start from %d, needs %d blocks\n", i, f->filnam, f->ext, blknr, n);
+		f->blocklist.count = 0;
 		for (j = 0; !overflow && j < n; j++) {
-			if (j >= sizeof(f->blocklist.blocknr)) {
- 			error_set(ERROR_FILESYSTEM_OVERFLOW, "File %s.%s too large, uses more than %d blocks", f->filnam,
-						f->ext, (int) sizeof(f->blocklist.blocknr));
-				overflow = 1;
-			} else if (blknr >= _this->blockcount) {
+			if (blknr >= _this->blockcount) {
 				error_set(ERROR_FILESYSTEM_OVERFLOW, "File system overflow, can hold max %d blocks.",
 						_this->blockcount);
 				overflow = 1;
-			} else {
-				_this->bitmap->used[blknr] = 1;
-				f->blocklist.blocknr[j] = blknr++;
-			}
+			} else
+				xxdp_blocklist_add(&f->blocklist, blknr++);
 		}
+		if (!overflow && n) // file blocks are consecutive
+			xxdp_bitmap_set_range(_this->bitmap, f->blocklist.blocknr[0], n);
 		f->block_count = n;
-		f->blocklist.count = n;
 		if (overflow)
 			return ERROR_FILESYSTEM_OVERFLOW;
 	}
@@ -763,43 +854,62 @@ static int xxdp_filesystem_layout(xxdp_filesystem_t *_this) {
  * create an binary image from logical datas structure
  **************************************************************/
 
+// mark blocks as rewritten. touched may be NULL
+static void touch_blocks(boolarray_t *touched, unsigned start, unsigned count) {
+	if (touched)
+		while (count--)
+			boolarray_bit_set(touched, start++);
+}
+
+// write blk[] into image block "blknr", if content differs.
+// Written blocks are "touched"
+static void render_block(xxdp_filesystem_t *_this, xxdp_blocknr_t blknr, uint8_t *blk,
+		boolarray_t *touched) {
+	uint8_t *dst = IMAGE_BLOCKNR2PTR(_this, blknr);
+	if (!memcmp(dst, blk, XXDP_BLOCKSIZE))
+		return;
+	memcpy(dst, blk, XXDP_BLOCKSIZE);
+	touch_blocks(touched, blknr, 1);
+}
+
 static void render_multiblock(xxdp_filesystem_t *_this, xxdp_multiblock_t *multiblock) {
 	uint8_t *dst = IMAGE_BLOCKNR2PTR(_this, multiblock->blocknr);
 	// write into sequential blocks.
 	memcpy(dst, multiblock->data, multiblock->data_size);
 }
 
+// write header and flag words of one bitmap block from used[]
+// blocklist already calculated
+static void render_bitmap_block(xxdp_filesystem_t *_this, int map_blkidx) {
+	xxdp_blocknr_t map_blknr = _this->bitmap->blocklist.blocknr[map_blkidx]; // abs pos bitmap blk
+	unsigned blknr = map_blkidx * XXDP_BITMAP_WORDS_PER_MAP * 16; // 1st block flag in map
+	int map_flags_wordnr;
+
+	xxdp_image_set_word(_this, map_blknr, 1, map_blkidx + 1); // "map number":  enumerates map blocks
+	xxdp_image_set_word(_this, map_blknr, 2, XXDP_BITMAP_WORDS_PER_MAP); // 60
+	xxdp_image_set_word(_this, map_blknr, 3, _this->bitmap->blocklist.blocknr[0]); // "link to first map"
+	for (map_flags_wordnr = 0; map_flags_wordnr < XXDP_BITMAP_WORDS_PER_MAP;
+			map_flags_wordnr++, blknr += 16) {
+		uint16_t map_flags = 0;
+		// same bit order as on disk. No flags beyond end of volume
+		if (blknr + 16 <= (unsigned) _this->blockcount)
+			map_flags = _this->bitmap->used[blknr / 16];
+		else if (blknr < (unsigned) _this->blockcount)
+			map_flags = _this->bitmap->used[blknr / 16] & ((1 << (_this->blockcount - blknr)) - 1);
+		xxdp_image_set_word(_this, map_blknr, map_flags_wordnr + 4, map_flags);
+	}
+}
+
 // write the bitmap words of all used[] blocks
 // blocklist already calculated
 static void render_bitmap(xxdp_filesystem_t *_this) {
-	xxdp_blocknr_t blknr;
+	unsigned map_blkidx;
 
 	// link blocks
 	xxdp_blocklist_set(_this, &(_this->bitmap->blocklist));
 
-	for (blknr = 0; blknr < _this->blockcount; blknr++) {
-		// which bitmap block resides the flag in?
-		int map_blkidx = blknr / (XXDP_BITMAP_WORDS_PER_MAP * 16); // # in list
-		int map_blknr = _this->bitmap->blocklist.blocknr[map_blkidx]; // abs pos bitmap blk
-		int map_flags_bitnr = blknr % (XXDP_BITMAP_WORDS_PER_MAP * 16);
-
-		// set metadata for the whole bitmap block only if first flag is processed
-		if (map_flags_bitnr == 0) {
-			xxdp_image_set_word(_this, map_blknr, 1, map_blkidx + 1); // "map number":  enumerates map blocks
-			xxdp_image_set_word(_this, map_blknr, 2, XXDP_BITMAP_WORDS_PER_MAP); // 60
-			xxdp_image_set_word(_this, map_blknr, 3, _this->bitmap->blocklist.blocknr[0]); // "link to first map"
-		}
-
-		// set a single block flag
-		if (_this->bitmap->used[blknr]) {
-			// word and bit in this block containing the flag
-			int map_flags_wordnr = map_flags_bitnr / 16;
-			int map_flag_bitpos = map_flags_bitnr % 16;
-			uint16_t map_flags = xxdp_image_get_word(_this, map_blknr, map_flags_wordnr + 4);
-			map_flags |= (1 << map_flag_bitpos);
-			xxdp_image_set_word(_this, map_blknr, map_flags_wordnr + 4, map_flags);
-		}
-	}
+	for (map_blkidx = 0; map_blkidx < _this->bitmap->blocklist.count; map_blkidx++)
+		render_bitmap_block(_this, map_blkidx);
 }
 
 // blocklist already calculated
@@ -854,77 +964,114 @@ static void render_mfd(xxdp_filesystem_t *_this) {
 		fatal("MFD variety must be 1 or 2");
 }
 
-static void render_ufd(xxdp_filesystem_t *_this) {
-	int file_idx ;
+// write the UFD entry of a file at word "ufd_word_offset" in block "ufd_blknr"
+// date_word: f->date encoded
+static void render_ufd_entry(xxdp_filesystem_t *_this, xxdp_blocknr_t ufd_blknr,
+		int ufd_word_offset, xxdp_file_t *f, uint16_t date_word) {
+	uint16_t w[3];
 	unsigned n;
+
+	rad50_encode_filename(f->filnam, f->ext, w);
+	xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 0, w[0]);
+	xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 1, w[1]);
+	xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 2, w[2]);
+
+	xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 3, date_word);
+
+	xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 4, 0); // ACT-11 logical end
+	xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 5, f->blocklist.blocknr[0]); // 1st block
+	xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 6, f->blocklist.count); // file length in blocks
+	n = f->blocklist.blocknr[f->blocklist.count - 1];
+	xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 7, n); // last block
+	xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 8, 0); // ACT-11 logical 52
+}
+
+static void render_ufd(xxdp_filesystem_t *_this) {
+	struct tm dates[XXDP_UFD_ENTRIES_PER_BLOCK];
+	uint16_t date_words[XXDP_UFD_ENTRIES_PER_BLOCK];
+	int file_idx, i, n;
 	// link blocks
 	xxdp_blocklist_set(_this, _this->ufd_blocklist);
 	//
 	for (file_idx = 0; file_idx < _this->file_count; file_idx++) {
-		char buff[80];
-		xxdp_blocknr_t ufd_blknr = _this->radi.ufd_block_1 + (file_idx / XXDP_UFD_ENTRIES_PER_BLOCK);
+		if (file_idx % XXDP_UFD_ENTRIES_PER_BLOCK == 0) {
+			// encode dates of all files in this UFD block
+			n = _this->file_count - file_idx;
+			if (n > XXDP_UFD_ENTRIES_PER_BLOCK)
+				n = XXDP_UFD_ENTRIES_PER_BLOCK;
+			for (i = 0; i < n; i++)
+				dates[i] = _this->file[file_idx + i]->date;
+			dos11date_encode_array(dates, date_words, n);
+		}
+		// UFD may extend from preallocated into free space
+		xxdp_blocknr_t ufd_blknr = _this->ufd_blocklist->blocknr[file_idx
+				/ XXDP_UFD_ENTRIES_PER_BLOCK];
 		// word nr of cur entry in cur block. skip link word.
 		int ufd_word_offset = 1 + (file_idx % XXDP_UFD_ENTRIES_PER_BLOCK) * XXDP_UFD_ENTRY_WORDCOUNT;
-		xxdp_file_t *f = _this->file[file_idx];
-
-		xxdp_blocklist_set(_this, &f->blocklist);
-
-		// filename chars 0..2
-		strncpy(buff, f->filnam, 3);
-		buff[3] = 0;
-		xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 0, rad50_encode(buff));
-		// filename chars 3..5
-		if (strlen(f->filnam) < 4)
-			buff[0] = 0;
-		else
-			strncpy(buff, f->filnam + 3, 3);
-		buff[3] = 0;
-		xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 1, rad50_encode(buff));
-		// ext
-		xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 2, rad50_encode(f->ext));
-
-		xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 3, dos11date_encode(f->date));
-
-		xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 4, 0); // ACT-11 logical end
-		xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 5, f->blocklist.blocknr[0]); // 1st block
-		xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 6, f->blocklist.count); // file length in blocks
-		n = f->blocklist.blocknr[f->blocklist.count - 1];
-		xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 7, n); // last block
-		xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + 8, 0); // ACT-11 logical 52
+		render_ufd_entry(_this, ufd_blknr, ufd_word_offset, _this->file[file_idx],
+				date_words[file_idx % XXDP_UFD_ENTRIES_PER_BLOCK]);
 	}
 }
 
-// write file->data[] into blocks of blocklist
-static void render_file_data(xxdp_filesystem_t *_this, xxdp_file_t *f) {
+// write file->data[] into blocks of blocklist, with link words.
+// Rest of last block cleared, only changed blocks are written and "touched"
+static void render_file_data(xxdp_filesystem_t *_this, xxdp_file_t *f, boolarray_t *touched) {
+	uint8_t blk[XXDP_BLOCKSIZE];
 	int bytestocopy = f->data_size;
 	unsigned i;
-	uint8_t *src, *dst;
+	uint8_t *src;
 	src = f->data;
 	for (i = 0; i < f->blocklist.count; i++) {
-		int blknr = f->blocklist.blocknr[i];
 		int block_datasize; // data amount in this block
 		assert(bytestocopy);
-		dst = IMAGE_BLOCKNR2PTR(_this, blknr) + 2; // write behind link word
+		memset(blk, 0, XXDP_BLOCKSIZE);
+		// link to next block, 0 in last
+		if (i + 1 < f->blocklist.count) {
+			blk[0] = f->blocklist.blocknr[i + 1] & 0xff;
+			blk[1] = (f->blocklist.blocknr[i + 1] >> 8) & 0xff;
+		}
 
 		// data amount =n block without link word
 		block_datasize = XXDP_BLOCKSIZE - 2;
 		// default: transfer full block
 		if (bytestocopy < block_datasize) // EOF?
 			block_datasize = bytestocopy;
-		memcpy(dst, src, block_datasize);
+		memcpy(blk + 2, src, block_datasize); // write behind link word
 		src += block_datasize;
 		bytestocopy -= block_datasize;
 		assert(src <= f->data + f->data_size);
+		render_block(_this, f->blocklist.blocknr[i], blk, touched);
 	}
 	assert(bytestocopy == 0);
 }
 
+// blocks from image start up to the last UFD or bitmap block:
+// boot, monitor, bitmap, MFD, UFD
+static unsigned xxdp_filesystem_metadata_blockcount(xxdp_filesystem_t *_this) {
+	xxdp_blocklist_t *bl[2] = { _this->ufd_blocklist, &_this->bitmap->blocklist };
+	unsigned i, j, result = _this->preallocated_blockcount;
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < bl[i]->count; j++)
+			if (bl[i]->blocknr[j] >= result)
+				result = bl[i]->blocknr[j] + 1;
+	return result;
+}
+
 // write filesystem into image
 // Assumes all file data and blocklists are valid
+// Only blocks with different content are written and marked in "touched" (may be NULL).
+// Free space is not cleared.
 // return: 0 = OK
-int xxdp_filesystem_render(xxdp_filesystem_t *_this) {
+int xxdp_filesystem_render(xxdp_filesystem_t *_this, boolarray_t *touched) {
 	int file_idx;
 	unsigned needed_size = (int) _this->blockcount * XXDP_BLOCKSIZE;
+	uint8_t *image_data = _this->image_data, *metadata;
+	uint32_t image_size = _this->image_size;
+	unsigned blknr, metadata_blockcount;
+
+	// parsed files: fetch data before blocks are moved
+	for (file_idx = 0; file_idx < _this->file_count; file_idx++)
+		xxdp_file_load(_this, _this->file[file_idx]);
 
 	// calc blocklists and sizes
 	if (xxdp_filesystem_layout(_this))
@@ -936,8 +1083,10 @@ int xxdp_filesystem_render(xxdp_filesystem_t *_this) {
 				"Image only %d bytes large, filesystem needs %d *%d = %d.", _this->image_size,
 				_this->blockcount, XXDP_BLOCKSIZE, needed_size);
 
-	// format media, all 0's
-	memset(_this->image_data, 0, _this->image_size);
+	// build metadata area in all 0's scratch buffer, unused UFD entries cleared
+	metadata_blockcount = xxdp_filesystem_metadata_blockcount(_this);
+	_this->image_data = calloc(metadata_blockcount, XXDP_BLOCKSIZE);
+	_this->image_size = metadata_blockcount * XXDP_BLOCKSIZE;
 
 	render_multiblock(_this, _this->bootblock);
 	render_multiblock(_this, _this->monitor);
@@ -946,9 +1095,16 @@ int xxdp_filesystem_render(xxdp_filesystem_t *_this) {
 	render_mfd(_this);
 	render_ufd(_this);
 
-	// read data for all user files
+	metadata = _this->image_data;
+	_this->image_data = image_data;
+	_this->image_size = image_size;
+	for (blknr = 0; blknr < metadata_blockcount; blknr++)
+		render_block(_this, blknr, metadata + blknr * XXDP_BLOCKSIZE, touched);
+	free(metadata);
+
+	// write data for all user files
 	for (file_idx = 0; file_idx < _this->file_count; file_idx++)
-		render_file_data(_this, _this->file[file_idx]);
+		render_file_data(_this, _this->file[file_idx], touched);
 	return ERROR_OK;
 }
 
@@ -961,11 +1117,12 @@ int xxdp_filesystem_render(xxdp_filesystem_t *_this) {
 // it never changes
 static void xxdp_filesystem_render_volumeinfo(xxdp_filesystem_t *_this, xxdp_file_t *f) {
 	// static stream instance as buffer for name=value text
-	static char text_buffer[4096 + XXDP_MAX_FILES_PER_IMAGE * 80]; // listing for all files
+	static THREAD_LOCAL char text_buffer[4096 + XXDP_MAX_FILES_PER_IMAGE * 80]; // listing for all files
 	char line[1024];
 	int file_idx;
 	time_t t = time(NULL);
-	struct tm tm = *localtime(&t);
+	struct tm tm;
+	localtime_r(&t, &tm);
 
 	text_buffer[0] = 0;
 	sprintf(line, "# %s.%s - info about XXDP volume on %s device.\n", f->filnam, f->ext,
@@ -1024,14 +1181,41 @@ static void xxdp_filesystem_render_volumeinfo(xxdp_filesystem_t *_this, xxdp_fil
 	f->data_size = strlen(text_buffer);
 }
 
+// mark the MFD, UFD and bitmap blocks in "mask".
+// A PDP write into these blocks changes the file list
+void xxdp_filesystem_metadata_blocks(xxdp_filesystem_t *_this, boolarray_t *mask) {
+	unsigned i;
+	for (i = 0; i < _this->mfd_blocklist->count; i++)
+		boolarray_bit_set(mask, _this->mfd_blocklist->blocknr[i]);
+	for (i = 0; i < _this->ufd_blocklist->count; i++)
+		boolarray_bit_set(mask, _this->ufd_blocklist->blocknr[i]);
+	for (i = 0; i < _this->bitmap->blocklist.count; i++)
+		boolarray_bit_set(mask, _this->bitmap->blocklist.blocknr[i]);
+}
+
+// set owner[blocknr] to the index of the file using that block.
+// owner[] is preset with -1 by caller
+void xxdp_filesystem_block_owners(xxdp_filesystem_t *_this, int *owner, unsigned block_count) {
+	unsigned i;
+	int file_idx;
+	for (file_idx = 0; file_idx < _this->file_count; file_idx++) {
+		xxdp_blocklist_t *bl = &_this->file[file_idx]->blocklist;
+		for (i = 0; i < bl->count; i++)
+			if (bl->blocknr[i] < block_count)
+				owner[bl->blocknr[i]] = file_idx;
+	}
+}
+
 // special indexes:
 // -1: bootblock
 // -2: monitor
 // -3: volume information text file
 // else regular file
 // fname: filnam.ext
+// borrow: 1 = data[] of regular files is not copied, must stay valid
+//	until filesystem_init() or _destroy()
 int xxdp_filesystem_file_add(xxdp_filesystem_t *_this, char *hostfname, time_t hostfdate,
-		uint8_t *data, uint32_t data_size) {
+		uint8_t *data, uint32_t data_size, int borrow) {
 
 	if (!strcasecmp(hostfname, XXDP_VOLUMEINFO_FILNAM "." XXDP_VOLUMEINFO_EXT)) {
 		// evaluate parameter file ?
@@ -1043,11 +1227,11 @@ int xxdp_filesystem_file_add(xxdp_filesystem_t *_this, char *hostfname, time_t h
 		_this->bootblock->data = realloc(_this->bootblock->data, data_size);
 		memcpy(_this->bootblock->data, data, data_size);
 	} else if (!strcasecmp(hostfname, XXDP_MONITOR_FILNAM "." XXDP_MONITOR_EXT)) {
-		// assume max len of monitor
-		int n = XXDP_BLOCKSIZE * (_this->preallocated_blockcount - _this->monitor->blocknr + 1);
-		if (n < 0 || data_size > (unsigned)n)
+		// monitor may not extend into file space
+		unsigned n = XXDP_BLOCKSIZE * xxdp_monitor_max_blockcount(_this);
+		if (data_size > n)
 			return error_set(ERROR_FILESYSTEM_OVERFLOW,
-					"Monitor too big: is %d bytes, only %d allowed", data_size, n);
+					"Monitor too big: is %u bytes, only %u allowed", data_size, n);
 		_this->monitor->data_size = data_size;
 		_this->monitor->data = realloc(_this->monitor->data, data_size);
 		memcpy(_this->monitor->data, data, data_size);
@@ -1074,15 +1258,21 @@ int xxdp_filesystem_file_add(xxdp_filesystem_t *_this, char *hostfname, time_t h
 						ext);
 		}
 		// now insert
-		f = malloc(sizeof(xxdp_file_t));
+		f = arena_alloc(_this->arena, sizeof(xxdp_file_t));
+		xxdp_blocklist_init(&f->blocklist);
 		_this->file[_this->file_count++] = f;
 		f->data_size = data_size;
-		f->data = malloc(data_size);
-		memcpy(f->data, data, data_size);
+		f->borrowed = borrow;
+		if (borrow)
+			f->data = data;
+		else {
+			f->data = malloc(data_size);
+			memcpy(f->data, data, data_size);
+		}
 		strcpy(f->filnam, filnam);
 		strcpy(f->ext, ext);
 
-		f->date = *localtime(&hostfdate);
+		localtime_r(&hostfdate, &f->date);
 		// only range 1970..1999 allowed
 		if (f->date.tm_year < 70)
 			f->date.tm_year = 70;
@@ -1092,12 +1282,251 @@ int xxdp_filesystem_file_add(xxdp_filesystem_t *_this, char *hostfname, time_t h
 	return ERROR_OK;
 }
 
+/**************************************************************
+ * Incremental update
+ * replace or delete single files of a parsed filesystem
+ * directly in the image. Only UFD entry, bitmap and the blocks of that file
+ * are rewritten, these blocks are marked in "touched" (may be NULL).
+ * ERROR_FILESYSTEM_OVERFLOW: change needs a new layout with _render()
+ **************************************************************/
+
+// index of file with name, padding spaces ignored. -1 if not found
+static int xxdp_filesystem_file_idx(xxdp_filesystem_t *_this, char *filnam, char *ext) {
+	uint16_t w[3], w1[3];
+	int file_idx;
+	rad50_encode_filename(filnam, ext, w);
+	for (file_idx = 0; file_idx < _this->file_count; file_idx++) {
+		xxdp_file_t *f = _this->file[file_idx];
+		rad50_encode_filename(strtrim(f->filnam), f->ext, w1);
+		if (!memcmp(w, w1, sizeof(w)))
+			return file_idx;
+	}
+	return -1;
+}
+
+// find UFD entry of a file in the image.
+// filnam == NULL: find an unused entry
+static int xxdp_filesystem_ufd_entry_find(xxdp_filesystem_t *_this, char *filnam, char *ext,
+		xxdp_blocknr_t *ufd_blknr, int *ufd_word_offset) {
+	uint16_t w[3] = { 0, 0, 0 };
+	unsigned i, j;
+	if (filnam)
+		rad50_encode_filename(filnam, ext, w);
+	for (i = 0; i < _this->ufd_blocklist->count; i++)
+		for (j = 0; j < XXDP_UFD_ENTRIES_PER_BLOCK; j++) {
+			xxdp_blocknr_t blknr = _this->ufd_blocklist->blocknr[i];
+			int wordnr = 1 + j * XXDP_UFD_ENTRY_WORDCOUNT;
+			if (xxdp_image_get_word(_this, blknr, wordnr) == w[0]
+					&& (!filnam
+							|| (xxdp_image_get_word(_this, blknr, wordnr + 1) == w[1]
+									&& xxdp_image_get_word(_this, blknr, wordnr + 2) == w[2]))) {
+				*ufd_blknr = blknr;
+				*ufd_word_offset = wordnr;
+				return ERROR_OK;
+			}
+		}
+	return error_set(ERROR_FILESYSTEM_OVERFLOW, NULL); // silent
+}
+
+// set used[] flags of a blocklist and mark the affected bitmap blocks
+static void xxdp_filesystem_bitmap_mark(xxdp_filesystem_t *_this, xxdp_blocklist_t *bl,
+		uint8_t used, uint8_t *map_dirty) {
+	unsigned i;
+	for (i = 0; i < bl->count; i++) {
+		xxdp_bitmap_set(_this->bitmap, bl->blocknr[i], used);
+		map_dirty[bl->blocknr[i] / (XXDP_BITMAP_WORDS_PER_MAP * 16)] = 1;
+	}
+}
+
+// rewrite changed bitmap blocks
+static void xxdp_filesystem_bitmap_update(xxdp_filesystem_t *_this, uint8_t *map_dirty,
+		boolarray_t *touched) {
+	unsigned i;
+	for (i = 0; i < _this->bitmap->blocklist.count; i++)
+		if (map_dirty[i]) {
+			render_bitmap_block(_this, i);
+			touch_blocks(touched, _this->bitmap->blocklist.blocknr[i], 1);
+		}
+}
+
+// add or replace a file in a parsed filesystem. See _file_add()
+int xxdp_filesystem_file_update(xxdp_filesystem_t *_this, char *hostfname, time_t hostfdate,
+		uint8_t *data, uint32_t data_size, boolarray_t *touched) {
+	uint8_t map_dirty[XXDP_MAX_BLOCKCOUNT / (XXDP_BITMAP_WORDS_PER_MAP * 16) + 1];
+	xxdp_blocklist_t *bl;
+	xxdp_blocknr_t ufd_blknr, blknr;
+	int ufd_word_offset;
+	char filnam[40], ext[40];
+	xxdp_file_t *f;
+	int file_idx;
+	unsigned i, n;
+
+	if (!strcasecmp(hostfname, XXDP_VOLUMEINFO_FILNAM "." XXDP_VOLUMEINFO_EXT))
+		return ERROR_OK; // generated, never written to image
+	if (!strcasecmp(hostfname, XXDP_BOOTBLOCK_FILNAM "." XXDP_BOOTBLOCK_EXT)) {
+		if (xxdp_filesystem_file_add(_this, hostfname, hostfdate, data, data_size, 0))
+			return error_code;
+		render_multiblock(_this, _this->bootblock);
+		touch_blocks(touched, _this->bootblock->blocknr, 1);
+		return ERROR_OK;
+	}
+	if (!strcasecmp(hostfname, XXDP_MONITOR_FILNAM "." XXDP_MONITOR_EXT)) {
+		// monitor may not extend into file space
+		n = xxdp_monitor_max_blockcount(_this);
+		if (data_size > n * XXDP_BLOCKSIZE)
+			return error_set(ERROR_FILESYSTEM_OVERFLOW, NULL);
+		if (xxdp_filesystem_file_add(_this, hostfname, hostfdate, data, data_size, 0))
+			return error_code;
+		memset(IMAGE_BLOCKNR2PTR(_this, _this->monitor->blocknr), 0, n * XXDP_BLOCKSIZE);
+		render_multiblock(_this, _this->monitor);
+		touch_blocks(touched, _this->monitor->blocknr, n);
+		return ERROR_OK;
+	}
+
+	// regular file
+	n = NEEDED_BLOCKS(XXDP_BLOCKSIZE - 2, data_size);
+	if (n == 0 || n > XXDP_MAX_BLOCKS_PER_LIST)
+		return error_set(ERROR_FILESYSTEM_OVERFLOW, NULL);
+	xxdp_filename_from_host(hostfname, filnam, ext);
+	file_idx = xxdp_filesystem_file_idx(_this, filnam, ext);
+	if (file_idx < 0) {
+		if (_this->file_count + 1 >= XXDP_MAX_FILES_PER_IMAGE)
+			return error_set(ERROR_FILESYSTEM_OVERFLOW, "Too many files, only %d allowed",
+			XXDP_MAX_FILES_PER_IMAGE);
+		// new file needs free UFD entry
+		if (xxdp_filesystem_ufd_entry_find(_this, NULL, NULL, &ufd_blknr, &ufd_word_offset))
+			return error_code;
+		f = arena_alloc(_this->arena, sizeof(xxdp_file_t));
+		f->data = NULL;
+		f->borrowed = 0;
+		xxdp_blocklist_init(&f->blocklist);
+		f->changed = 0;
+		f->fixed = 0;
+		strcpy(f->filnam, filnam);
+		strcpy(f->ext, ext);
+	} else {
+		f = _this->file[file_idx];
+		if (xxdp_filesystem_ufd_entry_find(_this, filnam, ext, &ufd_blknr, &ufd_word_offset))
+			return error_code;
+	}
+
+	// new blocklist: reuse old blocks, then first free ones
+	memset(map_dirty, 0, sizeof(map_dirty));
+	bl = malloc(sizeof(xxdp_blocklist_t));
+	xxdp_blocklist_init(bl);
+	xxdp_filesystem_bitmap_mark(_this, &f->blocklist, 0, map_dirty);
+	while (bl->count < n && bl->count < f->blocklist.count)
+		xxdp_blocklist_add(bl, f->blocklist.blocknr[bl->count]);
+	for (blknr = xxdp_bitmap_find_free(_this->bitmap, _this->preallocated_blockcount,
+			_this->blockcount); bl->count < n && blknr < _this->blockcount;
+			blknr = xxdp_bitmap_find_free(_this->bitmap, blknr + 1, _this->blockcount)) {
+		// not used by other files, not already in list
+		for (i = 0; i < bl->count && bl->blocknr[i] != blknr; i++)
+			;
+		if (i == bl->count)
+			xxdp_blocklist_add(bl, blknr);
+	}
+	if (bl->count < n) {
+		// disk full: restore
+		xxdp_filesystem_bitmap_mark(_this, &f->blocklist, 1, map_dirty);
+		xxdp_blocklist_free(bl);
+		free(bl);
+		return error_set(ERROR_FILESYSTEM_OVERFLOW, NULL);
+	}
+	xxdp_blocklist_free(&f->blocklist);
+	f->blocklist = *bl; // takes over blocknr[]
+	free(bl);
+	xxdp_filesystem_bitmap_mark(_this, &f->blocklist, 1, map_dirty);
+	f->block_count = n;
+
+	if (f->data && !f->borrowed)
+		free(f->data);
+	f->borrowed = 0;
+	f->data_size = data_size;
+	f->data = malloc(data_size);
+	memcpy(f->data, data, data_size);
+	localtime_r(&hostfdate, &f->date);
+	// only range 1970..1999 allowed
+	if (f->date.tm_year < 70)
+		f->date.tm_year = 70;
+	else if (f->date.tm_year > 99)
+		f->date.tm_year = 99;
+	if (file_idx < 0)
+		_this->file[_this->file_count++] = f;
+
+	// write data and links
+	render_file_data(_this, f, touched);
+
+	render_ufd_entry(_this, ufd_blknr, ufd_word_offset, f, dos11date_encode(f->date));
+	touch_blocks(touched, ufd_blknr, 1);
+	xxdp_filesystem_bitmap_update(_this, map_dirty, touched);
+	return ERROR_OK;
+}
+
+// remove a file from a parsed filesystem
+int xxdp_filesystem_file_delete(xxdp_filesystem_t *_this, char *hostfname, boolarray_t *touched) {
+	uint8_t map_dirty[XXDP_MAX_BLOCKCOUNT / (XXDP_BITMAP_WORDS_PER_MAP * 16) + 1];
+	xxdp_blocknr_t ufd_blknr;
+	int ufd_word_offset;
+	char filnam[40], ext[40];
+	xxdp_file_t *f;
+	int file_idx, i;
+
+	if (!strcasecmp(hostfname, XXDP_VOLUMEINFO_FILNAM "." XXDP_VOLUMEINFO_EXT))
+		return ERROR_OK;
+	if (!strcasecmp(hostfname, XXDP_BOOTBLOCK_FILNAM "." XXDP_BOOTBLOCK_EXT)) {
+		// all 00's = not present
+		memset(_this->bootblock->data, 0, _this->bootblock->data_size);
+		memset(IMAGE_BLOCKNR2PTR(_this, _this->bootblock->blocknr), 0, XXDP_BLOCKSIZE);
+		touch_blocks(touched, _this->bootblock->blocknr, 1);
+		return ERROR_OK;
+	}
+	if (!strcasecmp(hostfname, XXDP_MONITOR_FILNAM "." XXDP_MONITOR_EXT)) {
+		i = xxdp_monitor_max_blockcount(_this);
+		memset(_this->monitor->data, 0, _this->monitor->data_size);
+		memset(IMAGE_BLOCKNR2PTR(_this, _this->monitor->blocknr), 0, i * XXDP_BLOCKSIZE);
+		touch_blocks(touched, _this->monitor->blocknr, i);
+		return ERROR_OK;
+	}
+
+	xxdp_filename_from_host(hostfname, filnam, ext);
+	file_idx = xxdp_filesystem_file_idx(_this, filnam, ext);
+	if (file_idx < 0)
+		return ERROR_OK; // already gone
+	f = _this->file[file_idx];
+	if (xxdp_filesystem_ufd_entry_find(_this, filnam, ext, &ufd_blknr, &ufd_word_offset))
+		return error_code;
+	for (i = 0; i < XXDP_UFD_ENTRY_WORDCOUNT; i++)
+		xxdp_image_set_word(_this, ufd_blknr, ufd_word_offset + i, 0);
+	touch_blocks(touched, ufd_blknr, 1);
+
+	memset(map_dirty, 0, sizeof(map_dirty));
+	xxdp_filesystem_bitmap_mark(_this, &f->blocklist, 0, map_dirty);
+	xxdp_filesystem_bitmap_update(_this, map_dirty, touched);
+
+	memmove(&_this->file[file_idx], &_this->file[file_idx + 1],
+			(_this->file_count - file_idx - 1) * sizeof(xxdp_file_t *));
+	_this->file_count--;
+	_this->file[_this->file_count] = NULL;
+	if (f->data && !f->borrowed)
+		free(f->data);
+	xxdp_blocklist_free(&f->blocklist);
+	// f itself remains in the arena until next init()
+	return ERROR_OK;
+}
+
+// make data[] of a parsed file valid
+void xxdp_filesystem_file_load(xxdp_filesystem_t *_this, int fileidx) {
+	if (fileidx >= 0 && fileidx < (int)_this->file_count)
+		xxdp_file_load(_this, _this->file[fileidx]);
+}
+
 // access files, bootblock and monitor in an uniform way
 // -3 = volume info, -2 = monitor, -1 = boot block
 // bootblock or monitor are NULL, if empty
 xxdp_file_t *xxdp_filesystem_file_get(xxdp_filesystem_t *_this, int fileidx) {
 	xxdp_file_t *result = NULL;
-	static xxdp_file_t buff[3]; // buffers for monitor and bootblock
+	static THREAD_LOCAL xxdp_file_t buff[3]; // buffers for monitor and bootblock
 	if (fileidx == -3) {
 		result = &buff[0];
 		strcpy(result->filnam, XXDP_VOLUMEINFO_FILNAM);
@@ -1138,7 +1567,7 @@ xxdp_file_t *xxdp_filesystem_file_get(xxdp_filesystem_t *_this, int fileidx) {
 static char *xxdp_date_text(struct tm t) {
 	char *mon[] = { "JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV",
 			"DEC" };
-	static char buff[80];
+	static THREAD_LOCAL char buff[80];
 	sprintf(buff, "%02d-%3s-%02d", t.tm_mday, mon[t.tm_mon], t.tm_year);
 	return buff;
 }
@@ -1149,7 +1578,7 @@ static char *xxdp_date_text(struct tm t) {
 //     1  XXDPSM.SYS       1-MAR-89         29    000050   E.0
 //     2  XXDPXM.SYS       1-MAR-89         39    000105
 static char *xxdp_dir_line(xxdp_filesystem_t *_this, int fileidx) {
-	static char buff[80];
+	static THREAD_LOCAL char buff[80];
 	xxdp_file_t *f;
 	if (fileidx < 0)
 		return "ENTRY# FILNAM.EXT        DATE          LENGTH  START   VERSION";
@@ -1230,7 +1659,7 @@ void xxdp_filesystem_print_diag(xxdp_filesystem_t *_this, FILE *stream) {
 				}
 		}
 		// block marked in bitmap?
-		used = _this->bitmap->used[blknr];
+		used = BITMAP_USED(_this->bitmap, blknr);
 		if ((!used && line[0]) || (used && !line[0])) {
 			sprintf(buff, " Bitmap mismatch, marked as %s!", used ? "USED" : "NOT USED");
 			strcat(line, buff);
@@ -1247,7 +1676,7 @@ void xxdp_filesystem_print_diag(xxdp_filesystem_t *_this, FILE *stream) {
 
 /* convert filenames and timestamps */
 char *xxdp_filename_to_host(char *filnam, char *ext) {
-	static char result[80];
+	static THREAD_LOCAL char result[80];
 	char _filnam[80], _ext[80];
 	// remove surrounding spaces.
 	// all XXDP filename chars are valid host chars (" ", "$", "%")
@@ -1268,7 +1697,7 @@ char *xxdp_filename_to_host(char *filnam, char *ext) {
 // "filname" and "ext" contain components WITH spaces, if != NULL
 // "bla.foo.c" => "BLA.FO", "C  ", result = "BLA.FO.C"
 char *xxdp_filename_from_host(char *hostfname, char *filnam, char *ext) {
-	static char result[80];
+	static THREAD_LOCAL char result[80];
 	char pathbuff[4096];
 	char _filnam[7], _ext[4];
 	char *s, *t;
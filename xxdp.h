@@ -33,6 +33,11 @@
  *  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *
+ *  18-Oct-2026  JH  file index of blocks
+ *  18-Oct-2026  JH  files allocated from arena
+ *  18-Oct-2026  JH  file data loaded on demand
+ *  18-Oct-2026  JH  block lists allocated dynamically
+ *  18-Oct-2026  JH  bitmap packed into words
  *  07-May-2017  JH  passes GCC warning levels -Wall -Wextra
  *  12-Jan-2017  JH  created
  */
@@ -43,6 +48,7 @@
 #include <stdint.h>
 #include <time.h>
 
+#include "arena.h"
 #include "boolarray.h"
 #include "device_info.h"
 #include "utils.h"
@@ -62,7 +68,7 @@
 #define XXDP_UFD_ENTRIES_PER_BLOCK	28 // 29 file entries per UFD block
 // own limits
 #define	XXDP_MAX_FILES_PER_IMAGE 1000
-#define XXDP_MAX_BLOCKS_PER_LIST       1024  //  own: max filesize: * 510
+#define XXDP_MAX_BLOCKS_PER_LIST       XXDP_MAX_BLOCKCOUNT  //  own: max filesize: * 510
 
 // pseudo file for volume parameters
 #define XXDP_VOLUMEINFO_FILNAM	"$VOLUM" // valid XXDP file name
@@ -87,7 +93,8 @@ typedef struct {
 
 typedef struct {
 	unsigned count;
-	xxdp_blocknr_t blocknr[XXDP_MAX_BLOCKS_PER_LIST]; // later dynamic?
+	unsigned capacity; // allocated entries in blocknr[]
+	xxdp_blocknr_t *blocknr; // grows on demand
 } xxdp_blocklist_t;
 
 // a range of block which is treaed as one byte stream
@@ -101,9 +108,11 @@ typedef struct {
 } xxdp_multiblock_t;
 
 // boolean marker for block usage
+// "used" flags packed like the map words on disk: 16 blocks per word, LSB = lowest blocknr
+#define XXDP_BITMAP_WORDS	(XXDP_MAX_BLOCKCOUNT / 16)
 typedef struct {
 	xxdp_blocklist_t blocklist ;
-	uint8_t used[XXDP_MAX_BLOCKCOUNT];
+	uint16_t used[XXDP_BITMAP_WORDS];
 } xxdp_bitmap_t;
 
 typedef struct {
@@ -115,7 +124,8 @@ typedef struct {
 	xxdp_blocknr_t block_count ; // saved blockcount from UFD.
 	// UFD should not differ from blocklist.count !
 	uint32_t data_size; // byte count in data[]
-	uint8_t *data; // dynamic array with 'size' entries
+	uint8_t *data; // dynamic array with 'size' entries. Parsed: NULL until _file_load()
+	uint8_t borrowed; // 1: data[] is owned by caller (mapped host file), not freed
 	struct tm date; // file date. only y,m,d valid
 	uint8_t	changed ; // calc'd from image_changed_blocks
 	int	fixed ; // is part of filesystem, can not be deleted
@@ -151,6 +161,8 @@ typedef struct {
 
 	// blocks used by User File Directory
 	xxdp_blocklist_t *ufd_blocklist;
+	boolarray_t *chain_visited; // blocks of the chain in xxdp_blocklist_get(), else clear
+	arena_t *arena; // xxdp_file_t of file[], reset by init()
 	int file_count; // signed, because there are negative file_idx
 	xxdp_file_t *file[XXDP_MAX_FILES_PER_IMAGE];
 } xxdp_filesystem_t;
@@ -175,11 +187,22 @@ void xxdp_filesystem_init(xxdp_filesystem_t *_this) ;
 int xxdp_filesystem_parse(xxdp_filesystem_t *_this);
 
 int xxdp_filesystem_file_add(xxdp_filesystem_t *_this,char *hostfname, time_t hostfdate,
-		uint8_t *data, uint32_t data_size) ;
+		uint8_t *data, uint32_t data_size, int borrow) ;
 
 // write filesystem into image
-int xxdp_filesystem_render(xxdp_filesystem_t *_this);
+int xxdp_filesystem_render(xxdp_filesystem_t *_this, boolarray_t *touched);
 
+// modify a parsed filesystem
+int xxdp_filesystem_file_update(xxdp_filesystem_t *_this, char *hostfname, time_t hostfdate,
+		uint8_t *data, uint32_t data_size, boolarray_t *touched);
+int xxdp_filesystem_file_delete(xxdp_filesystem_t *_this, char *hostfname, boolarray_t *touched);
+
+// mark MFD, UFD and bitmap blocks of a parsed filesystem
+void xxdp_filesystem_metadata_blocks(xxdp_filesystem_t *_this, boolarray_t *mask);
+// file index for each block, -1 if not in a file
+void xxdp_filesystem_block_owners(xxdp_filesystem_t *_this, int *owner, unsigned block_count);
+
+void xxdp_filesystem_file_load(xxdp_filesystem_t *_this, int fileidx);
 xxdp_file_t *xxdp_filesystem_file_get(xxdp_filesystem_t *_this, int fileidx) ;
 
 void xxdp_filesystem_print_dir(xxdp_filesystem_t *_this, FILE *stream) ;